@@ -0,0 +1,147 @@
+// Runs the microbenchmarks of the core hot paths:
+//
+//     sample_and_graph_bench [--filter <substring>] [--json <file>]
+//
+// Results are printed as a table, --json also writes them to a file so they can be compared between releases.
+
+#include "Bench.hpp"
+#include "AllocCounter.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace bench
+{
+volatile char g_sink{0};
+
+namespace
+{
+struct Benchmark {
+    std::string           name;
+    std::function<void()> op;
+    size_t                bytes_per_op;
+};
+
+constexpr auto MinBatchTime = std::chrono::milliseconds(20);
+constexpr int  Batches      = 7;
+
+std::vector<Benchmark>& Benchmarks()
+{
+    static std::vector<Benchmark> benchmarks;
+    return benchmarks;
+}
+
+double BatchNs(Benchmark const& b, size_t iterations)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i)
+        b.op();
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+Result Measure(Benchmark const& b)
+{
+    // Also warms up caches and lazily allocated buffers
+    size_t iterations = 1;
+    while (BatchNs(b, iterations) < std::chrono::duration<double, std::nano>(MinBatchTime).count() && iterations < (1u << 30))
+        iterations *= 2;
+
+    std::vector<double> ns;
+    auto                allocations = AllocCounter::Thread();
+    for (int i = 0; i < Batches; ++i)
+        ns.push_back(BatchNs(b, iterations) / iterations);
+    allocations = AllocCounter::Thread() - allocations;
+
+    std::nth_element(ns.begin(), ns.begin() + Batches / 2, ns.end());
+    Result r;
+    r.name               = b.name;
+    r.iterations         = iterations;
+    r.ns_per_op          = ns[Batches / 2];
+    r.bytes_per_s        = b.bytes_per_op * 1e9 / r.ns_per_op;
+    r.allocations_per_op = static_cast<double>(allocations) / (static_cast<double>(iterations) * Batches);
+    return r;
+}
+
+std::string Escape(std::string const& str)
+{
+    std::string out;
+    for (char c : str) {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        out += c;
+    }
+    return out;
+}
+} // namespace
+
+void Register(std::string const& name, std::function<void()> op, size_t bytes_per_op)
+{
+    Benchmarks().push_back({name, std::move(op), bytes_per_op});
+}
+
+std::vector<Result> Run(std::string const& filter)
+{
+    std::vector<Result> results;
+    std::printf("%-40s %12s %12s %12s\n", "benchmark", "ns/op", "MB/s", "allocs/op");
+    for (auto const& b : Benchmarks()) {
+        if (b.name.find(filter) == std::string::npos)
+            continue;
+        auto r = Measure(b);
+        if (r.bytes_per_s > 0)
+            std::printf("%-40s %12.1f %12.1f %12.2f\n", r.name.c_str(), r.ns_per_op, r.bytes_per_s / 1e6, r.allocations_per_op);
+        else
+            std::printf("%-40s %12.1f %12s %12.2f\n", r.name.c_str(), r.ns_per_op, "-", r.allocations_per_op);
+        results.push_back(r);
+    }
+    return results;
+}
+
+void WriteJson(std::vector<Result> const& results, std::string const& fname)
+{
+    std::ofstream ofs(fname);
+    if (!ofs)
+        throw std::runtime_error("Can't open " + fname);
+
+    ofs << "{\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        auto const& r = results[i];
+        ofs << "    {\"name\": \"" << Escape(r.name) << "\", \"iterations\": " << r.iterations << ", \"ns_per_op\": " << r.ns_per_op
+            << ", \"bytes_per_s\": " << r.bytes_per_s << ", \"allocations_per_op\": " << r.allocations_per_op << "}"
+            << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    ofs << "  ]\n}\n";
+}
+} // namespace bench
+
+int main(int argc, char* argv[])
+{
+    std::string filter, json;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (arg == "--json" && i + 1 < argc) {
+            json = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--filter <substring>] [--json <file>]\n";
+            return 1;
+        }
+    }
+
+    bench::RegisterSignalBenchmarks();
+    bench::RegisterCoreBenchmarks();
+    bench::RegisterChartBenchmarks();
+
+    try {
+        auto results = bench::Run(filter);
+        if (!json.empty())
+            bench::WriteJson(results, json);
+    } catch (std::exception const& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Minimal microbenchmark harness. A benchmark is an operation that is run in batches, the batch size is doubled until
+// a batch takes long enough to time reliably and the reported time is the median of several batches, so results are
+// repeatable between runs. Allocations are counted with AllocCounter over all timed batches.
+namespace bench
+{
+struct Result {
+    std::string name;
+    size_t      iterations{0}; // per batch
+    double      ns_per_op{0};
+    double      bytes_per_s{0}; // 0 if the benchmark doesn't process bytes
+    double      allocations_per_op{0};
+};
+
+// bytes_per_op - bytes processed by one call of op, for the throughput
+void Register(std::string const& name, std::function<void()> op, size_t bytes_per_op = 0);
+
+std::vector<Result> Run(std::string const& filter); // benchmarks whose name contains filter
+void                WriteJson(std::vector<Result> const& results, std::string const& fname);
+
+// Keeps the compiler from optimizing away a result, it has to exist in memory for the read of its first byte
+extern volatile char g_sink;
+
+template <typename T>
+void DoNotOptimize(T const& value)
+{
+    g_sink = *reinterpret_cast<volatile char const*>(&value);
+}
+
+// Registration functions of the individual files
+void RegisterSignalBenchmarks();
+void RegisterCoreBenchmarks();
+void RegisterChartBenchmarks();
+} // namespace bench
@@ -0,0 +1,40 @@
+// ChartSignal::UpdataCurve (through SetView), what a drawn signal costs every frame: reading the visible samples and
+// their times out of the stores, reducing them to min and max per pixel column, converting and building the
+// vertices. Zoomed in a pixel column shows one sample, zoomed out many.
+
+#include "Bench.hpp"
+#include "Chart.hpp"
+#include "Conversion.hpp"
+#include <memory>
+#include <random>
+
+void bench::RegisterChartBenchmarks()
+{
+    constexpr uint32_t PeriodMs = 100;
+    constexpr uint32_t Samples  = 1000000;
+    constexpr float    Width    = 1230;
+
+    std::mt19937 rng(1);
+    auto         node = std::make_shared<Node>("PU1_1");
+    auto         time = std::make_shared<TimeColumn>();
+    for (uint32_t i = 0; i < Samples; ++i) {
+        node->push_back(1500 + rng() % 1000);
+        time->push_back({i * PeriodMs, i});
+    }
+
+    auto signal = std::make_shared<ChartSignal>(sf::FloatRect(0.f, 0.f, Width, 660.f));
+    signal->MaxVal(100.f);
+    signal->Source(node->shared_buffer(), [](const uint32_t* raw, float* out, size_t count) {
+        Conversion::NtcTemperature(raw, out, count);
+    });
+    signal->Time(time, PeriodMs);
+
+    for (int samples_per_pixel : {1, 16, 256}) {
+        auto ms_per_pixel = static_cast<float>(samples_per_pixel * PeriodMs);
+        Register("chart/update_curve_" + std::to_string(samples_per_pixel) + "_per_pixel", [signal, ms_per_pixel] {
+            signal->SetView(0, ms_per_pixel);
+            DoNotOptimize(signal->Vertices());
+        },
+                 static_cast<size_t>(Width) * samples_per_pixel * sizeof(uint32_t));
+    }
+}
@@ -0,0 +1,180 @@
+// Hot paths of the acquisition core: packet parsing of received streams, config tokenizing, serialization of nodes
+// and devices, raw to temperature conversion and node statistics.
+
+#include "Bench.hpp"
+#include "Conversion.hpp"
+#include "Device.hpp"
+#include "Helpers.hpp"
+#include "NodeStatistics.hpp"
+#include <memory>
+#include <random>
+
+namespace
+{
+constexpr int Nodes   = 16;
+constexpr int Packets = 256;
+
+std::vector<uint8_t> PacketStream(std::mt19937& rng, size_t garbage_per_packet)
+{
+    std::vector<uint8_t> stream;
+    for (uint32_t id = 0; id < Packets; ++id) {
+        for (size_t i = 0; i < garbage_per_packet; ++i)
+            stream.push_back(static_cast<uint8_t>(rng()));
+
+        DataPacket::Header header{DataPacket::HEADER_START_ID, Nodes * sizeof(uint32_t), id};
+        auto               p = reinterpret_cast<uint8_t const*>(&header);
+        stream.insert(stream.end(), p, p + sizeof(header));
+        for (int n = 0; n < Nodes; ++n) {
+            uint32_t val = 1500 + rng() % 1000;
+            p            = reinterpret_cast<uint8_t const*>(&val);
+            stream.insert(stream.end(), p, p + sizeof(val));
+        }
+    }
+    return stream;
+}
+
+// Parses every packet of the stream as PhysicalDevice::ReadData does, reading it in chunks of chunk_size bytes
+struct ParseFixture {
+    std::vector<uint8_t> stream;
+    std::vector<uint8_t> buffer;
+    size_t               chunk_size;
+
+    void operator()()
+    {
+        size_t packets = 0;
+        buffer.clear();
+        for (size_t pos = 0; pos < stream.size(); pos += chunk_size) {
+            buffer.insert(buffer.end(), stream.begin() + pos, stream.begin() + std::min(stream.size(), pos + chunk_size));
+
+            size_t offset = 0;
+            for (size_t consumed = 0;; offset += consumed) {
+                auto dp = DataPacket::Parse(buffer.data() + offset, buffer.size() - offset, consumed);
+                if (!dp) {
+                    offset += consumed;
+                    break;
+                }
+                packets++;
+            }
+            buffer.erase(buffer.begin(), buffer.begin() + offset);
+        }
+        bench::DoNotOptimize(packets);
+    }
+};
+
+// Serializer::append is only available to serializers
+struct Appender : Serializer {
+    ser_data_t Serialize() const override { return {}; }
+    void       Deserialize(ser_data_t&) override {}
+    using Serializer::append;
+};
+
+Node MakeNode(std::mt19937& rng, size_t samples)
+{
+    Node node("PU1_1");
+    for (size_t i = 0; i < samples; ++i)
+        node.push_back(1500 + rng() % 1000);
+    return node;
+}
+
+void RegisterPackets(std::mt19937& rng)
+{
+    auto clean = PacketStream(rng, 0);
+    bench::Register("packet/parse_clean", ParseFixture{clean, {}, clean.size()}, clean.size());
+    bench::Register("packet/parse_fragmented", ParseFixture{clean, {}, 61}, clean.size());
+    auto garbage = PacketStream(rng, 64);
+    bench::Register("packet/parse_garbage", ParseFixture{garbage, {}, 4096}, garbage.size());
+
+    bench::Register("packet/extract_clean", [clean]() mutable {
+        auto data    = clean;
+        int  packets = 0;
+        while (DataPacket::Extract(data))
+            packets++;
+        bench::DoNotOptimize(packets);
+    },
+                    clean.size());
+}
+
+void RegisterSerialization(std::mt19937& rng)
+{
+    std::string line = "node,PU1_1,PU1_2,PU1_3,PU1_4,PU1_5,PU1_6,PU1_7,PU1_8,PU2_1,PU2_2,PU2_3,PU2_4";
+    bench::Register("helpers/tokenize_string", [line] { bench::DoNotOptimize(Help::TokenizeString(line, ",").size()); }, line.size());
+
+    bench::Register("serializer/append_int", [data = Serializer::ser_data_t()]() mutable {
+        data.clear();
+        for (uint32_t i = 0; i < 64; ++i)
+            Appender::append(data, 1500u + i);
+        bench::DoNotOptimize(data.size());
+    });
+    bench::Register("serializer/append_float", [data = Serializer::ser_data_t()]() mutable {
+        data.clear();
+        for (int i = 0; i < 64; ++i)
+            Appender::append(data, 25.f + i * 0.125f);
+        bench::DoNotOptimize(data.size());
+    });
+
+    constexpr size_t Samples = 10000;
+    auto             node    = std::make_shared<Node>(MakeNode(rng, Samples));
+    auto             ser     = node->Serialize();
+    bench::Register("node/serialize", [node] { bench::DoNotOptimize(node->Serialize().size()); }, ser.size());
+    bench::Register("node/deserialize", [ser] {
+        auto data = ser;
+        Node node;
+        node.Deserialize(data);
+        bench::DoNotOptimize(node.buffer().size());
+    },
+                    ser.size());
+
+    auto device = std::make_shared<VirtualDevice>();
+    device->SetID(1);
+    device->SetName("dev1");
+    for (int n = 0; n < Nodes; ++n)
+        device->push_back(MakeNode(rng, Samples / Nodes));
+    auto dev_ser = device->Serialize();
+    bench::Register("device/serialize", [device] { bench::DoNotOptimize(device->Serialize().size()); }, dev_ser.size());
+    bench::Register("device/deserialize", [dev_ser] {
+        auto          data = dev_ser;
+        VirtualDevice device;
+        device.Deserialize(data);
+        bench::DoNotOptimize(device.GetNodes().size());
+    },
+                    dev_ser.size());
+}
+
+void RegisterProcessing(std::mt19937& rng)
+{
+    // One read worth of samples of a node
+    constexpr size_t      Samples = 1024;
+    std::vector<uint32_t> raw(Samples);
+    for (auto& r : raw)
+        r = 1500 + rng() % 1000;
+
+    bench::Register("conversion/ntc_temperature", [raw, out = std::vector<float>(Samples)]() mutable {
+        Conversion::NtcTemperature(raw.data(), out.data(), raw.size());
+        bench::DoNotOptimize(out[0]);
+    },
+                    Samples * sizeof(uint32_t));
+
+    std::vector<float> values(Samples);
+    Conversion::NtcTemperature(raw.data(), values.data(), raw.size());
+    // 10 samples per second, every run continues where the previous one ended
+    std::vector<TimeColumn::Entry> times(Samples);
+    for (size_t i = 0; i < Samples; ++i)
+        times[i].time_ms = static_cast<uint32_t>(i * 100);
+    auto statistics = std::make_shared<NodeStatistics>();
+    statistics->Configure({{"1min", 60 * 1000}, {"1h", 60 * 60 * 1000}});
+    bench::Register("statistics/update", [statistics, values, times]() mutable {
+        for (auto& t : times)
+            t.time_ms += Samples * 100;
+        statistics->Update(values.data(), times.data(), values.size());
+    },
+                    Samples * sizeof(float));
+}
+} // namespace
+
+void bench::RegisterCoreBenchmarks()
+{
+    std::mt19937 rng(1);
+    RegisterPackets(rng);
+    RegisterSerialization(rng);
+    RegisterProcessing(rng);
+}
@@ -0,0 +1,85 @@
+// Time to load a capture with 64 nodes (parsing, statistics) with 1, 2, 4, ... workers up to every core of the task
+// pool. The time spent in task groups with one worker is the part of loading that runs in parallel, from it the
+// speedup on machines with more cores is estimated (Amdahl's law) next to the measured ones.
+
+#include "Acquisition.hpp"
+#include "TaskPool.hpp"
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <thread>
+
+namespace
+{
+constexpr int Nodes   = 64;
+constexpr int Samples = 20000;
+constexpr int Runs    = 3;
+
+std::string WriteCapture()
+{
+    auto          fname = (std::filesystem::temp_directory_path() / "sample_and_graph_load_bench.txt").string();
+    std::ofstream ofs(fname);
+    std::mt19937  rng(1);
+
+    ofs << "Thu Jan  1 00:00:00 1970\nsampling_period,100ms\n";
+    for (int d = 0; d < 2; ++d) {
+        ofs << "device," << d + 1 << ",dev" << d + 1 << "\n";
+        for (int n = 0; n < Nodes / 2; ++n) {
+            ofs << "node,N" << d << "_" << n;
+            for (int i = 0; i < Samples; ++i)
+                ofs << "," << 1500 + rng() % 1000;
+            ofs << "\n";
+        }
+    }
+    return fname;
+}
+
+struct LoadTime {
+    double seconds;
+    double parallel_seconds; // of it spent in task groups
+};
+
+LoadTime Load(std::string const& fname)
+{
+    LoadTime best{1e9, 0};
+    for (int r = 0; r < Runs; ++r) {
+        Acquisition acquisition;
+        auto        parallel = TaskPool::Get().ParallelNs();
+        auto        start    = std::chrono::steady_clock::now();
+        acquisition.Load(fname);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (seconds < best.seconds)
+            best = {seconds, (TaskPool::Get().ParallelNs() - parallel) / 1e9};
+    }
+    return best;
+}
+} // namespace
+
+int main()
+{
+    auto   fname = WriteCapture();
+    size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    std::printf("%d nodes x %d samples, %zu cores\n", Nodes, Samples, cores);
+
+    TaskPool::Get().Resize(1);
+    auto serial = Load(fname);
+    std::printf("%2d workers: %8.3f s\n", 1, serial.seconds);
+    for (size_t workers = 2; workers < 2 * cores; workers *= 2) {
+        workers = std::min(workers, cores);
+        TaskPool::Get().Resize(workers);
+        auto parallel = Load(fname);
+        std::printf("%2zu workers: %8.3f s  speedup %.2fx\n", workers, parallel.seconds, serial.seconds / parallel.seconds);
+    }
+    TaskPool::Get().Resize(0);
+
+    double p = std::min(1., serial.parallel_seconds / serial.seconds);
+    std::printf("parallel part: %.1f %% of the load time with 1 worker\nexpected speedup:", 100 * p);
+    for (int n : {2, 4, 8, 16})
+        std::printf("  %d cores %.2fx", n, 1 / ((1 - p) + p / n));
+    std::printf("\n");
+
+    std::filesystem::remove(fname);
+    return 0;
+}
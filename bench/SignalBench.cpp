@@ -0,0 +1,46 @@
+// Emission cost of lsignal::signal (as signal_new_data used it, with a device vector built for every emission)
+// against lsignal::fast_signal with a span of devices, for 1 to 16 connected slots.
+
+#include "Bench.hpp"
+#include "lsignal.hpp"
+#include <memory>
+
+namespace
+{
+struct Device {
+    int id;
+};
+
+volatile int g_sum{0};
+
+struct Fixture {
+    std::vector<Device>                                             storage{4};
+    std::vector<Device*>                                            devices;
+    std::vector<Device const*>                                      views;
+    lsignal::signal<void(std::vector<Device const*> const&)>        signal;
+    lsignal::fast_signal<void(lsignal::span<Device const* const>)> fast;
+
+    explicit Fixture(int slots)
+    {
+        for (auto& d : storage)
+            devices.push_back(&d);
+        views.assign(devices.begin(), devices.end());
+        for (int i = 0; i < slots; ++i) {
+            signal.connect([](std::vector<Device const*> const& d) { g_sum = g_sum + d[0]->id; });
+            fast.connect([](lsignal::span<Device const* const> d) { g_sum = g_sum + d[0]->id; });
+        }
+    }
+};
+} // namespace
+
+void bench::RegisterSignalBenchmarks()
+{
+    for (int slots : {1, 2, 4, 8, 16}) {
+        auto fixture = std::make_shared<Fixture>(slots);
+        Register("signal/" + std::to_string(slots) + "_slots", [fixture] {
+            std::vector<Device const*> copy(fixture->devices.begin(), fixture->devices.end());
+            fixture->signal(copy);
+        });
+        Register("fast_signal/" + std::to_string(slots) + "_slots", [fixture] { fixture->fast(fixture->views); });
+    }
+}
@@ -0,0 +1,220 @@
+#include "Communication.hpp"
+#include "Device.hpp"
+#include "Helpers.hpp"
+#include "Simulation.hpp"
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <stdexcept>
+
+namespace
+{
+// Simulated end of a connection, state of the board it is connected to
+struct Port {
+    int                  board{-1};
+    bool                 running{false};
+    uint32_t             next_id{0};
+    double               next_due_ms{0};
+    std::vector<uint8_t> rx;
+};
+
+constexpr int MaxPacketsPerPoll = 10000; // a stalled reader doesn't make one poll generate a huge burst
+
+std::mutex                                 g_mtx;
+Simulation::Settings                       g_settings;
+std::chrono::steady_clock::time_point      g_start{std::chrono::steady_clock::now()};
+std::map<Communication const*, Port>       g_ports;
+
+void Reply(Port& port, std::string const& line)
+{
+    port.rx.insert(port.rx.end(), line.begin(), line.end());
+}
+
+void Generate(Port& port)
+{
+    auto now = Simulation::Now();
+    for (int n = 0; port.running && port.next_due_ms <= now && n < MaxPacketsPerPoll; ++n) {
+        DataPacket::Header header{DataPacket::HEADER_START_ID, static_cast<uint32_t>(g_settings.nodes * sizeof(uint32_t)), port.next_id};
+        auto               p = reinterpret_cast<uint8_t const*>(&header);
+        port.rx.insert(port.rx.end(), p, p + sizeof(header));
+        for (int i = 0; i < g_settings.nodes; ++i) {
+            // Slow daily swing, different per node
+            uint32_t val = 2000 + static_cast<uint32_t>(400 * std::sin(port.next_due_ms / 86400000. * 6.283 + i + port.board));
+            p            = reinterpret_cast<uint8_t const*>(&val);
+            port.rx.insert(port.rx.end(), p, p + sizeof(val));
+        }
+        port.next_id++;
+        port.next_due_ms += g_settings.period_ms;
+    }
+}
+
+size_t Take(Port& port, void* buffer, size_t size)
+{
+    size = std::min(size, port.rx.size());
+    std::copy(port.rx.begin(), port.rx.begin() + size, static_cast<uint8_t*>(buffer));
+    port.rx.erase(port.rx.begin(), port.rx.begin() + size);
+    return size;
+}
+} // namespace
+
+void Simulation::Configure(Settings const& settings)
+{
+    std::scoped_lock<std::mutex> sl(g_mtx);
+    g_settings = settings;
+    g_start    = std::chrono::steady_clock::now();
+}
+
+double Simulation::Now()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - g_start).count() * g_settings.speed;
+}
+
+Communication::Communication() :
+    m_serial("", 460800)
+{
+}
+
+Communication::~Communication()
+{
+    Disconnect();
+}
+
+bool Communication::Connect(const std::string& port)
+{
+    std::scoped_lock<std::mutex> sl(g_mtx);
+    if (port.rfind("sim", 0) != 0)
+        return false;
+    g_ports[this].board = std::stoi(port.substr(3));
+    m_is_connected      = true;
+    return true;
+}
+
+void Communication::Disconnect()
+{
+    std::scoped_lock<std::mutex> sl(g_mtx);
+    g_ports.erase(this);
+    m_is_connected = false;
+}
+
+size_t Communication::GetRxBufferLen()
+{
+    std::scoped_lock<std::mutex> sl(g_mtx);
+    auto                         it = g_ports.find(this);
+    if (it == g_ports.end())
+        return 0;
+    Generate(it->second);
+    return it->second.rx.size();
+}
+
+size_t Communication::Write(const void* buffer, int size)
+{
+    return Write(std::string(static_cast<char const*>(buffer), size));
+}
+
+// Commands are answered with their echo, ID_G with the board id
+size_t Communication::Write(const std::string& buffer)
+{
+    std::scoped_lock<std::mutex> sl(g_mtx);
+    auto                         it = g_ports.find(this);
+    if (it == g_ports.end())
+        return 0;
+
+    auto& port = it->second;
+    auto  cmd  = Help::TokenizeString(buffer, ",\n");
+    if (cmd.empty())
+        return buffer.size();
+    if (cmd[0] == "ID_G") {
+        Reply(port, "ID_G," + std::to_string(port.board + 1) + "\n");
+        return buffer.size();
+    }
+    if (cmd[0] == "STRT") {
+        port.running     = true;
+        port.next_due_ms = Simulation::Now();
+    } else if (cmd[0] == "STOP") {
+        port.running = false;
+    }
+    Reply(port, buffer);
+    return buffer.size();
+}
+
+size_t Communication::Read(void* buffer, int size)
+{
+    std::scoped_lock<std::mutex> sl(g_mtx);
+    auto                         it = g_ports.find(this);
+    return it == g_ports.end() ? 0 : Take(it->second, buffer, size);
+}
+
+size_t Communication::Read(std::vector<uint8_t>& buffer, size_t size)
+{
+    buffer.resize(size);
+    buffer.resize(Read(buffer.data(), static_cast<int>(size)));
+    return buffer.size();
+}
+
+size_t Communication::ReadAll(std::vector<uint8_t>& buffer)
+{
+    return Read(buffer, GetRxBufferLen());
+}
+
+std::string Communication::Readline()
+{
+    std::scoped_lock<std::mutex> sl(g_mtx);
+    auto                         it = g_ports.find(this);
+    if (it == g_ports.end())
+        return "";
+
+    auto& rx  = it->second.rx;
+    auto  end = std::find(rx.begin(), rx.end(), '\n');
+    if (end != rx.end())
+        ++end;
+    std::string line(rx.begin(), end);
+    rx.erase(rx.begin(), end);
+    return line;
+}
+
+void Communication::Flush() {}
+
+void Communication::Purge()
+{
+    std::scoped_lock<std::mutex> sl(g_mtx);
+    if (auto it = g_ports.find(this); it != g_ports.end())
+        it->second.rx.clear();
+}
+
+std::vector<serial::PortInfo> Communication::ListAllPorts()
+{
+    std::vector<serial::PortInfo> ports;
+    for (int i = 0; i < g_settings.boards; ++i)
+        ports.push_back({"sim" + std::to_string(i), "STMicroelectronics Virtual COM Port", ""});
+    return ports;
+}
+
+std::vector<std::string> Communication::ListFreePorts()
+{
+    std::scoped_lock<std::mutex> sl(g_mtx);
+    std::vector<std::string>     ports;
+    for (int i = 0; i < g_settings.boards; ++i) {
+        bool used = false;
+        for (auto const& [comm, port] : g_ports)
+            used |= port.board == i;
+        if (!used)
+            ports.push_back("sim" + std::to_string(i));
+    }
+    return ports;
+}
+
+void Communication::SetTimeout(int) {}
+
+void Communication::ConfirmTransmission(std::string const& str)
+{
+    auto sent     = Help::TokenizeString(str, ", \n");
+    auto received = Help::TokenizeString(Readline(), ", \n");
+    if (sent != received)
+        throw std::runtime_error("Transmission failed when sending: \"" + str + "\"");
+}
+
+std::vector<std::string> Communication::WriteAndTokenizeResult(std::string const& str)
+{
+    Write(str);
+    return Help::TokenizeString(Readline(), ",\n");
+}
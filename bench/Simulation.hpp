@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+
+// Simulated boards behind Communication, linked into the soak harness instead of src/Communication.cpp. Board i is
+// found on port "sim<i>", answers ID_G with i + 1 and, once started, streams a packet of `nodes` samples every
+// `period_ms` of simulated time. Simulated time runs `speed` times faster than real time.
+namespace Simulation
+{
+struct Settings {
+    int      boards{2};
+    int      nodes{8};
+    uint32_t period_ms{100};
+    double   speed{1000};
+};
+
+void   Configure(Settings const& settings); // also restarts simulated time
+double Now();                               // simulated ms since Configure
+} // namespace Simulation
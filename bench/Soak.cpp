@@ -0,0 +1,254 @@
+// Soak test: drives Acquisition with simulated boards at an accelerated clock and watches memory, allocations and
+// latency over a simulated week, so slow growth shows up in minutes instead of days:
+//
+//     sample_and_graph_soak [--boards 2] [--nodes 8] [--period 100] [--days 7] [--speed 1000] [--interval 6]
+//                           [--retention 256] [--csv soak.csv] [--rss-budget 64] [--alloc-budget 0.05]
+//                           [--latency-budget 2]
+//
+// Every --interval simulated hours a row goes to the CSV. At the end the last quarter of the rows is compared with
+// the first quarter (medians, so single hiccups don't count): RSS not explained by samples held in RAM may grow by
+// --rss-budget MB, allocations per packet by --alloc-budget and p99 latencies by a factor of --latency-budget.
+// Receive times are taken from the real clock, so they are compressed by --speed.
+
+#include "Acquisition.hpp"
+#include "AllocCounter.hpp"
+#include "Profiler.hpp"
+#include "Retention.hpp"
+#include "Simulation.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <thread>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace
+{
+struct Options {
+    Simulation::Settings simulation;
+    double               days{7};
+    double               interval_h{6};
+    int                  retention_mb{256};
+    std::string          csv{"soak.csv"};
+    double               rss_budget_mb{64};
+    double               alloc_budget{0.05};
+    double               latency_budget{2};
+};
+
+struct Row {
+    double hours;
+    double rss_mb;
+    double stored_mb;  // samples held in RAM
+    double spilled_mb; // samples spilled to disk
+    double allocations_per_packet;
+    double frame_p99_us;
+    double stage_p99_us[3]; // SerialRead, PacketExtract, Conversion
+};
+
+constexpr Profiler::Stage Stages[] = {Profiler::Stage::SerialRead, Profiler::Stage::PacketExtract, Profiler::Stage::Conversion};
+
+double RssMb()
+{
+#ifdef __linux__
+    std::ifstream statm("/proc/self/statm");
+    size_t        size = 0, resident = 0;
+    statm >> size >> resident;
+    return resident * static_cast<double>(sysconf(_SC_PAGESIZE)) / (1024 * 1024);
+#else
+    return 0;
+#endif
+}
+
+Options ParseArguments(int argc, char* argv[])
+{
+    Options opts;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg   = argv[i];
+        auto        value = [&]() -> std::string {
+            if (i + 1 >= argc)
+                throw std::invalid_argument("Missing value for argument '" + arg + "'");
+            return argv[++i];
+        };
+
+        if (arg == "--boards")
+            opts.simulation.boards = std::stoi(value());
+        else if (arg == "--nodes")
+            opts.simulation.nodes = std::stoi(value());
+        else if (arg == "--period")
+            opts.simulation.period_ms = std::stoul(value());
+        else if (arg == "--speed")
+            opts.simulation.speed = std::stod(value());
+        else if (arg == "--days")
+            opts.days = std::stod(value());
+        else if (arg == "--interval")
+            opts.interval_h = std::stod(value());
+        else if (arg == "--retention")
+            opts.retention_mb = std::stoi(value());
+        else if (arg == "--csv")
+            opts.csv = value();
+        else if (arg == "--rss-budget")
+            opts.rss_budget_mb = std::stod(value());
+        else if (arg == "--alloc-budget")
+            opts.alloc_budget = std::stod(value());
+        else if (arg == "--latency-budget")
+            opts.latency_budget = std::stod(value());
+        else
+            throw std::invalid_argument("Unknown argument '" + arg + "'");
+    }
+    opts.csv = fs::absolute(opts.csv).string();
+    return opts;
+}
+
+// config.txt for the simulated boards, Acquisition reads it from the working directory
+void WriteConfig(Options const& opts)
+{
+    std::ofstream ofs("config.txt");
+    ofs << "sampling_period " << opts.simulation.period_ms << "ms\n";
+    ofs << "retention_ram " << opts.retention_mb << "MB\n";
+    for (int b = 0; b < opts.simulation.boards; ++b) {
+        ofs << "device board" << b + 1 << "\nid " << b + 1 << "\nnodes";
+        for (int n = 0; n < opts.simulation.nodes; ++n)
+            ofs << " N" << b + 1 << "_" << n + 1;
+        ofs << "\n";
+    }
+}
+
+using Field = std::function<double(Row const&)>;
+
+double Median(std::vector<Row> const& rows, size_t begin, size_t end, Field const& field)
+{
+    std::vector<double> v;
+    for (size_t i = begin; i < end; ++i)
+        v.push_back(field(rows[i]));
+    std::nth_element(v.begin(), v.begin() + v.size() / 2, v.end());
+    return v[v.size() / 2];
+}
+
+// Medians of the last quarter against the first one, false if a budget is exceeded
+bool CheckBudgets(std::vector<Row> const& rows, Options const& opts)
+{
+    if (rows.size() < 4) {
+        std::cerr << "Too few samples to check budgets, make the run longer or the interval shorter\n";
+        return false;
+    }
+
+    size_t quarter = rows.size() / 4;
+    bool   ok      = true;
+    auto   check   = [&](std::string const& name, Field const& field, std::function<bool(double, double)> const& within) {
+        double first = Median(rows, 0, quarter, field);
+        double last  = Median(rows, rows.size() - quarter, rows.size(), field);
+        bool   pass  = within(first, last);
+        std::printf("%-28s %12.3f -> %12.3f  %s\n", name.c_str(), first, last, pass ? "ok" : "EXCEEDED");
+        ok &= pass;
+    };
+
+    // Memory that isn't samples in RAM: leaks and fragmentation
+    check("rss - stored [MB]", [](Row const& r) { return r.rss_mb - r.stored_mb; }, [&](double f, double l) { return l - f <= opts.rss_budget_mb; });
+    check("allocations/packet", [](Row const& r) { return r.allocations_per_packet; }, [&](double f, double l) { return l - f <= opts.alloc_budget; });
+
+    // Latencies below 10 us are noise
+    auto latency = [&](double f, double l) { return l <= std::max(f, 10.) * opts.latency_budget; };
+    check("frame p99 [us]", [](Row const& r) { return r.frame_p99_us; }, latency);
+    for (int s = 0; s < 3; ++s)
+        check(std::string(Profiler::Name(Stages[s])) + " p99 [us]", [s](Row const& r) { return r.stage_p99_us[s]; }, latency);
+    return ok;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    using namespace std::chrono_literals;
+
+    Options opts;
+    try {
+        opts = ParseArguments(argc, argv);
+    } catch (std::exception const& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    auto dir = fs::temp_directory_path() / "sample_and_graph_soak";
+    fs::create_directories(dir);
+    fs::current_path(dir);
+    WriteConfig(opts);
+
+    std::ofstream csv(opts.csv);
+    if (!csv) {
+        std::cerr << "Can't open " << opts.csv << "\n";
+        return 1;
+    }
+    csv << "hours,rss_mb,stored_mb,spilled_mb,allocations_per_packet,frame_p99_us";
+    for (auto stage : Stages) {
+        std::string name = Profiler::Name(stage);
+        std::replace(name.begin(), name.end(), ' ', '_');
+        csv << "," << name << "_p99_us";
+    }
+    csv << "\n";
+
+    std::vector<Row> rows;
+    try {
+        Simulation::Configure(opts.simulation);
+        Acquisition acquisition;
+        acquisition.ConnectToDevices();
+        acquisition.StartDevices();
+
+        auto&               profiler    = Profiler::Get();
+        auto                packets     = profiler.Total(Profiler::Counter::Packets);
+        auto                allocations = AllocCounter::Total();
+        Profiler::Histogram frames;
+        const double        end_ms      = opts.days * 24 * 3600 * 1000;
+        const double        interval_ms = opts.interval_h * 3600 * 1000;
+        double              next_row_ms = interval_ms;
+
+        while (Simulation::Now() < end_ms) {
+            auto start = std::chrono::steady_clock::now();
+            acquisition.ReadData();
+            frames.Record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+            profiler.Tick();
+
+            if (Simulation::Now() >= next_row_ms) {
+                auto new_packets     = profiler.Total(Profiler::Counter::Packets) - packets;
+                auto new_allocations = AllocCounter::Total() - allocations;
+
+                Row row;
+                row.hours                  = next_row_ms / (3600 * 1000);
+                row.rss_mb                 = RssMb();
+                row.stored_mb              = profiler.Value(Profiler::Gauge::BufferBytes) / (1024. * 1024.);
+                row.spilled_mb             = profiler.Value(Profiler::Gauge::SpilledBytes) / (1024. * 1024.);
+                row.allocations_per_packet = new_packets ? static_cast<double>(new_allocations) / new_packets : 0;
+                row.frame_p99_us           = frames.Percentile(0.99) / 1000.;
+                for (int s = 0; s < 3; ++s)
+                    row.stage_p99_us[s] = profiler.Summary(Stages[s]).p99_ns / 1000.;
+                rows.push_back(row);
+
+                csv << row.hours << "," << row.rss_mb << "," << row.stored_mb << "," << row.spilled_mb << ","
+                    << row.allocations_per_packet << "," << row.frame_p99_us;
+                for (auto p99 : row.stage_p99_us)
+                    csv << "," << p99;
+                csv << std::endl;
+
+                packets     = profiler.Total(Profiler::Counter::Packets);
+                allocations = AllocCounter::Total();
+                frames.Clear();
+                next_row_ms += interval_ms;
+            }
+
+            std::this_thread::sleep_for(1ms); // roughly a frame of the GUI loop
+        }
+
+        acquisition.DisconnectFromDevices();
+    } catch (std::exception const& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+
+    std::cout << "Simulated " << opts.days << " days, " << rows.size() << " samples written to " << opts.csv << "\n";
+    return CheckBudgets(rows, opts) ? 0 : 1;
+}
@@ -1,23 +1,36 @@
 #pragma once
 
+#include "Alarms.hpp"
 #include "Device.hpp"
+#include "Hotplug.hpp"
+#include "MetricsExporter.hpp"
+#include "SharedRing.hpp"
+#include "StreamServer.hpp"
 #include "lsignal.hpp"
+#include <chrono>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <optional>
 
 class Acquisition : public Serializer
 {
 public:
-    // Signals
-    lsignal::signal<void(std::vector<BaseDevice const*> const&)> signal_new_data;
-    lsignal::signal<void(std::vector<BaseDevice const*> const&)> signal_devices_loaded;
+    // Signals, new data is emitted on every read with new samples, so it doesn't lock or allocate
+    lsignal::fast_signal<void(lsignal::span<BaseDevice const* const>)> signal_new_data;
+    lsignal::signal<void(std::vector<BaseDevice const*> const&)>       signal_devices_loaded;
+    lsignal::signal<void(Alarm const&)>                                signal_alarm;
 
     Acquisition() = default;
     ~Acquisition();
 
     virtual ser_data_t Serialize() const;
     virtual void       Deserialize(ser_data_t& data);
+    ser_data_t         SerializeRaw() const;
 
     bool     ToggleConnect(); // return true if connected and false if disconnected
     void     ConnectToDevices();
+    void     Reconnect(); // reprobe only failed, changed and new devices of config.txt
     void     DisconnectFromDevices();
     bool     ToggleStart();
     void     StartDevices();
@@ -34,15 +47,72 @@ private:
     using LineTokens = std::vector<std::string>;
 
     // Methods
-    AllTokens ParseConfigFile(const std::string& file_name);
-    void      ConfigureFromTokens(AllTokens all_tokens);
+    ser_data_t SerializeHeader(uint32_t sampling_period_ms) const;
+    AllTokens  ParseConfigFile(const std::string& file_name);
+    void       ConfigureFromTokens(AllTokens all_tokens);
+    void       UpdateBufferGauges() const;
+    void       ProcessNewSamples(BaseDevice& device, std::optional<size_t> first_node = std::nullopt);
+    void       ProcessNode(BaseDevice const& device, Node& node, std::optional<size_t> alarm_node, std::vector<uint32_t>& raw,
+                           std::vector<float>& values, std::vector<TimeColumn::Entry>& times);
+    void       ReportAlarms();
+    void       Probe(); // reconnect m_probing in the background
+    void       FinishReconnect(bool wait);
+    void       WatchHotplug();
+    bool       Probing(PhysicalDevice const* dev) const;
+    void       ApplyDeviceDefaults(std::vector<PhysicalDevice*> const& devices) const;
+    void       CompileAlarms();
+    void       ApplyStreamSettings();
+    void       ApplyMetricsSettings();
+    void       ApplySharedRing();
+    void       PublishDevices();
+    void       PublishNewSamples(size_t device); // index in m_physical_devices
 
     // Members
-    std::vector<PhysicalDevice*> m_physical_devices;
-    std::vector<VirtualDevice*>  m_virtual_devices;
+    std::vector<PhysicalDevice*>   m_physical_devices;
+    std::vector<VirtualDevice*>    m_virtual_devices;
+    std::vector<BaseDevice const*> m_physical_views; // m_physical_devices as passed to signal_new_data
+    std::vector<PhysicalDevice*>   m_probing;        // devices Reconnect is probing, they aren't touched until it's done
+    std::future<void>              m_probe;
+
+    HotplugWatcher                                       m_hotplug;
+    std::optional<std::chrono::steady_clock::time_point> m_reattach_at; // probe dropped devices, a port appeared
 
     bool m_devices_connected{false};
     bool m_devices_running{false};
 
-    uint32_t m_sampling_period_ms{0};
+    uint32_t m_sampling_period_ms{0}; // default of the devices, they may set their own
+
+    std::optional<std::chrono::steady_clock::time_point> m_time_origin; // of receive times, set on first start
+
+    // Sliding windows of node statistics, name and length in ms
+    std::vector<std::pair<std::string, uint32_t>> m_statistics_windows{{"1min", 60 * 1000}, {"1h", 60 * 60 * 1000}};
+
+    AlarmEngine        m_alarms;
+    std::vector<Alarm> m_alarm_events; // raised or cleared during the current read
+    std::string        m_alarm_log_fname{"alarms.log"};
+    std::ofstream      m_alarm_log;
+
+    // Scratch for new samples of a node, raw, converted and their receive times
+    std::vector<uint32_t>          m_new_raw;
+    std::vector<float>             m_new_values;
+    std::vector<TimeColumn::Entry> m_new_times;
+
+    // Live samples for local TCP clients, if configured
+    std::optional<StreamServer::Settings> m_stream_settings;
+    std::unique_ptr<StreamServer>         m_stream_server;
+
+    // Profiler metrics for a Prometheus scraper, if configured
+    std::optional<MetricsExporter::Settings> m_metrics_settings;
+    std::unique_ptr<MetricsExporter>         m_metrics_exporter;
+
+    // Live samples in shared memory for local processes, if configured: name and length of the history in ms
+    std::optional<std::pair<std::string, uint32_t>> m_ring_settings;
+    std::unique_ptr<SharedRing::Writer>             m_shared_ring;
+
+    // New samples as they are published to the stream server and the shared ring
+    std::vector<size_t>            m_published; // per physical device, number of samples already published
+    std::vector<TimeColumn::Entry> m_publish_entries;
+    std::vector<SharedRing::Time>  m_publish_times;
+    std::vector<uint32_t>          m_publish_raw;
+    std::vector<float>             m_publish_values; // node after node
 };
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct Alarm {
+    enum class Kind { High, Low, Rate };
+
+    std::string node;
+    Kind        kind;
+    bool        raised;       // false - alarm cleared
+    float       value;        // temperature, or rate of change in units per second for Rate
+    float       limit;
+    uint64_t    sample_index; // index of the sample in the node's history
+
+    std::string ToString() const;
+};
+
+// Threshold and rate of change alarms of node values. Rules are compiled into a flat table sorted by node, where
+// every kind is reduced to comparing sign * input against a set and a clear threshold (hysteresis), so evaluating
+// a batch is a tight loop over the node's rules without branching on the rule kind.
+class AlarmEngine
+{
+public:
+    // Arguments of the 'alarm' config command: <node|prefix*|*> <high|low|rate> <limit> [hysteresis],
+    // throws std::invalid_argument
+    void AddRule(std::vector<std::string> const& args);
+    void ClearRules();
+    bool Empty() const { return m_table.empty(); }
+
+    // Resolve rules to node indices, clears all alarms. sampling_periods_ms - period of the stored samples of every
+    // node, nodes of different devices may be sampled at different rates.
+    void Compile(std::vector<std::string> const& node_names, std::vector<uint32_t> const& sampling_periods_ms);
+
+    // Values of node (index into node_names of Compile), first - sample index of values[0]. Raised and cleared
+    // alarms are appended to events.
+    void Evaluate(size_t node, const float* values, size_t n, uint64_t first, std::vector<Alarm>& events);
+    // Samples of node are missing, the rate of the next one isn't taken across them
+    void Gap(size_t node);
+
+    static const char* Name(Alarm::Kind kind);
+
+private:
+    struct Rule {
+        std::string pattern;
+        Alarm::Kind kind;
+        float       limit;
+        float       hysteresis;
+    };
+
+    struct Entry {
+        float       sign;  // -1 for low alarms
+        float       set;   // raised when sign * input > set
+        float       clear; // stays raised while sign * input >= clear
+        bool        rate;  // input is the absolute rate of change instead of the value
+        bool        active;
+        Alarm::Kind kind;
+        float       limit;
+    };
+
+    std::vector<Rule>        m_rules;
+    std::vector<Entry>       m_table;
+    std::vector<size_t>      m_node_begin; // entries of node i are [m_node_begin[i], m_node_begin[i + 1])
+    std::vector<std::string> m_node_names;
+    std::vector<float>       m_prev;          // last value of every node, NaN if there is none yet
+    std::vector<float>       m_rate;          // scratch for rates of the evaluated batch
+    std::vector<float>       m_samples_per_s; // of every node
+};
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstdint>
+
+// Counts heap allocations made through the global operator new, used to verify that hot paths don't allocate
+namespace AllocCounter
+{
+uint64_t Thread(); // allocations made by the calling thread so far
+uint64_t Total();  // allocations made by all threads so far
+} // namespace AllocCounter
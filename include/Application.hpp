@@ -8,6 +8,7 @@ class Application
 private:
     std::unique_ptr<MainWindow>  m_mainWindow;
     std::unique_ptr<Acquisition> m_acquisition;
+    lsignal::event_queue         m_gui_events; // queued emissions, drained by the main loop once per frame
 
 public:
     Application();
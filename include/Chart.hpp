@@ -1,7 +1,10 @@
 #pragma once
 
 #include "Device.hpp"
+#include "Profiler.hpp"
 #include "lsignal.hpp"
+#include <algorithm>
+#include <functional>
 #include <memory>
 #include <mygui/Object.hpp>
 #include <mygui/ResourceManager.hpp>
@@ -9,6 +12,8 @@
 class ChartSignal : public sf::Drawable
 {
 public:
+    using converter_type = std::function<void(const uint32_t*, float*, size_t)>; // raw samples to displayed values
+
     ChartSignal(const sf::FloatRect& region) :
         m_graph_region(region)
     {
@@ -20,38 +25,77 @@ public:
 
     virtual void draw(sf::RenderTarget& target, sf::RenderStates states) const override
     {
-        if (enabled && m_curve.size() > 0) {
-            target.draw(&m_curve[0], m_curve.size(), sf::PrimitiveType::LineStrip, states);
+        if (m_enabled && m_curve.size() > 0) {
+            // One line strip per part between gaps
+            size_t begin = 0;
+            for (auto end : m_breaks) {
+                target.draw(m_curve.data() + begin, end - begin, sf::PrimitiveType::LineStrip, states);
+                begin = end;
+            }
+            target.draw(m_curve.data() + begin, m_curve.size() - begin, sf::PrimitiveType::LineStrip, states);
             if (m_curve.back().position.y > 0)
                 target.draw(m_text);
         }
     }
 
-    const auto& Data() const { return m_data; }
+    // Signal shows the samples of source converted with converter, the store is only read and is shared with its node
+    void Source(std::shared_ptr<Node::Store const> const& source, converter_type const& converter)
+    {
+        m_source    = source;
+        m_converter = converter;
+        m_size      = 0;
+        Update();
+    }
 
-    void Append(std::vector<float> const& data)
+    // Pick up samples appended to the source since the last call, the curve is rebuilt by SetView
+    void Update()
     {
-        for (auto d : data) {
-            m_data.push_back(d);
-        }
+        if (!m_source)
+            return;
 
-        if (!m_draw_index_overwrite && m_draw_index <= (m_data.size() - m_graph_region.width)) {
-            int idx = m_data.size() - m_graph_region.width - 1;
-            if (idx < 0)
-                idx = 0;
-            m_draw_index = idx;
-        }
+        m_size = static_cast<int>(m_source->size());
+    }
+
+    // Receive times of the source samples and the period they are stored at. Without times (captures made before
+    // they were recorded) sample i is placed at i * sampling_period_ms.
+    void Time(std::shared_ptr<TimeColumn const> const& time, int sampling_period_ms)
+    {
+        m_time               = time;
+        m_sampling_period_ms = sampling_period_ms;
+    }
+
+    int SamplingPeriod() const { return m_sampling_period_ms; }
+
+    // Time of sample idx in ms
+    uint32_t TimeAt(int idx) const
+    {
+        if (HasTime())
+            return (*m_time)[idx].time_ms;
+        return static_cast<uint32_t>(idx) * m_sampling_period_ms;
+    }
 
-        UpdataCurve();
+    uint32_t LastTime() const { return m_size > 0 ? TimeAt(m_size - 1) : 0; }
+
+    // Index of the first sample at or after time_ms
+    int IndexAt(uint32_t time_ms) const
+    {
+        if (HasTime())
+            return std::min(static_cast<int>(m_time->LowerBound(time_ms)), m_size);
+        if (m_sampling_period_ms <= 0)
+            return 0;
+        return std::min(static_cast<int>((time_ms + m_sampling_period_ms - 1) / m_sampling_period_ms), m_size);
     }
 
+    int Size() const { return m_size; }
+
+    size_t Vertices() const { return m_enabled ? m_curve.size() : 0; } // submitted by draw
+
     void Clear()
     {
-        m_data.clear();
-        auto size = m_curve.size();
+        m_size = 0;
         m_curve.clear();
-        m_curve.resize(size);
-        m_draw_index = {0};
+        m_breaks.clear();
+        m_start_ms = 0;
     }
 
     void Name(std::string name)
@@ -62,47 +106,111 @@ public:
     }
     std::string Name() { return m_name; }
 
+    size_t ResidentBytes() const { return m_source ? m_source->ResidentBytes() : 0; }
+
+    // Statistics of the source node, kept up to date by the acquisition
+    void                                         Statistics(std::shared_ptr<NodeStatistics const> const& stats) { m_statistics = stats; }
+    std::shared_ptr<NodeStatistics const> const& Statistics() const { return m_statistics; }
+
     void MaxVal(float max_val)
     {
         m_max_val = max_val;
     }
     float MaxVal() { return m_max_val; }
 
-    bool enabled{true};
-
-    void ChangeDrawIndex(int draw_index_delta)
+    // A disabled signal isn't drawn and its curve isn't rebuilt, it is rebuilt for the current view when it is
+    // enabled again
+    void Enabled(bool enabled)
     {
-        m_draw_index += draw_index_delta;
-        if (m_draw_index < 0)
-            m_draw_index = 0;
-        if (m_draw_index > m_data.size())
-            m_draw_index = m_data.size() - 1;
-
-        if (m_data.size() - m_draw_index < m_graph_region.width)
-            m_draw_index_overwrite = false;
-        else
-            m_draw_index_overwrite = true;
-
-        UpdataCurve();
+        if (enabled && !m_enabled) {
+            m_enabled = true;
+            UpdataCurve();
+        } else if (!enabled) {
+            m_enabled = false;
+            m_curve.clear();
+            m_breaks.clear();
+        }
     }
+    bool Enabled() const { return m_enabled; }
 
-    int GetDrawIndex() const
+    // Show samples from start_ms onwards. All signals of a chart share the view, so signals of devices with
+    // different sampling periods are drawn on one time axis, every one of them at its own rate.
+    void SetView(uint32_t start_ms, float ms_per_pixel)
     {
-        return m_draw_index;
+        m_start_ms     = start_ms;
+        m_ms_per_pixel = ms_per_pixel;
+
+        if (m_enabled)
+            UpdataCurve();
     }
 
+    uint32_t GetViewStart() const { return m_start_ms; }
+
 private:
+    // Every pixel column shows min and max of the samples in its time span (conversions are monotonic so they
+    // stay the extremes), columns without samples are skipped and gaps break the line
     void UpdataCurve()
     {
-        if (m_data.size() <= 0)
+        m_curve.clear();
+        m_breaks.clear();
+
+        if (m_size <= 0 || m_sampling_period_ms <= 0 || m_ms_per_pixel <= 0)
             return;
 
-        const float y_zero = m_graph_region.top + m_graph_region.height;
-        int         startx = m_graph_region.left;
+        Profiler::ScopedTimer timer(Profiler::Stage::CurveRebuild);
 
-        m_curve.clear();
-        for (auto it = m_data.begin() + m_draw_index; it != m_data.end() && m_curve.size() <= m_graph_region.width; ++it) {
-            m_curve.push_back({sf::Vector2f(startx++, y_zero - (*it / m_max_val) * m_graph_region.height), sf::Color::Black});
+        int first = IndexAt(m_start_ms);
+        if (first >= m_size)
+            return;
+
+        // Only the visible part is copied out of the store (which pages it in if it was spilled), with a bit
+        // of headroom for devices running faster than their nominal period
+        const float width = m_graph_region.width;
+        size_t      n     = std::min<size_t>(m_size - first, width * m_ms_per_pixel / m_sampling_period_ms * 1.01f + 2);
+        m_raw.resize(n);
+        m_raw.resize(m_source->Read(first, m_raw.size(), m_raw.data()));
+
+        m_times.resize(m_raw.size());
+        if (HasTime()) {
+            m_times.resize(m_time->Read(first, m_times.size(), m_times.data()));
+        } else {
+            for (size_t i = 0; i < m_times.size(); ++i)
+                m_times[i].time_ms = static_cast<uint32_t>(first + i) * m_sampling_period_ms;
+        }
+
+        auto column = [&](size_t i) { return static_cast<int>((m_times[i].time_ms - m_start_ms) / m_ms_per_pixel); };
+
+        m_reduced.clear();
+        m_columns.clear();
+        for (size_t i = 0, j; i < m_times.size(); i = j) {
+            int col = column(i);
+            if (col > width)
+                break;
+            for (j = i + 1; j < m_times.size() && column(j) == col;)
+                ++j;
+            auto minmax = MinMax(m_raw.begin() + i, m_raw.begin() + j);
+            m_reduced.push_back(minmax.first);
+            m_reduced.push_back(minmax.second);
+            m_columns.push_back(col);
+        }
+
+        m_window.resize(m_reduced.size());
+        if (m_converter)
+            m_converter(m_reduced.data(), m_window.data(), m_reduced.size());
+        else
+            std::copy(m_reduced.begin(), m_reduced.end(), m_window.begin());
+
+        const float y_zero = m_graph_region.top + m_graph_region.height;
+        auto        to_y   = [&](float val) { return y_zero - (val / m_max_val) * m_graph_region.height; };
+        for (size_t c = 0; c < m_columns.size(); ++c) {
+            if (m_reduced[2 * c] == Node::Store::Missing) {
+                Break();
+                continue;
+            }
+            float x = m_graph_region.left + m_columns[c];
+            m_curve.push_back({sf::Vector2f(x, to_y(m_window[2 * c])), sf::Color::Black});
+            if (m_window[2 * c + 1] != m_window[2 * c])
+                m_curve.push_back({sf::Vector2f(x, to_y(m_window[2 * c + 1])), sf::Color::Black});
         }
 
         // Update text positions
@@ -112,14 +220,52 @@ private:
         }
     }
 
-private:
-    int m_sampling_period_ms{0};
+    // Min and max of the present samples, both Missing if there are none
+    template <typename It>
+    static std::pair<uint32_t, uint32_t> MinMax(It begin, It end)
+    {
+        uint32_t min = Node::Store::Missing, max = 0;
+        bool     any = false;
+        for (auto it = begin; it != end; ++it) {
+            if (*it == Node::Store::Missing)
+                continue;
+            min = std::min(min, *it);
+            max = std::max(max, *it);
+            any = true;
+        }
+        return any ? std::make_pair(min, max) : std::make_pair(Node::Store::Missing, Node::Store::Missing);
+    }
+
+    // Next vertex starts a new line
+    void Break()
+    {
+        if (!m_curve.empty() && (m_breaks.empty() || m_breaks.back() != m_curve.size()))
+            m_breaks.push_back(m_curve.size());
+    }
 
-    std::vector<float>      m_data;
-    int                     m_draw_index{0};
-    bool                    m_draw_index_overwrite{false};
-    std::vector<sf::Vertex> m_curve;
-    sf::FloatRect           m_graph_region;
+    bool HasTime() const { return m_time && m_time->size() >= static_cast<size_t>(m_size); }
+
+private:
+    int m_sampling_period_ms{0}; // of the source samples
+
+    std::shared_ptr<Node::Store const> m_source;
+    converter_type                     m_converter{nullptr};
+    int                                m_size{0};   // number of source samples the signal knows about
+    std::vector<uint32_t>              m_raw;       // visible part of m_source
+    std::vector<float>                 m_window;    // converted m_reduced
+
+    std::shared_ptr<TimeColumn const> m_time;
+    std::vector<TimeColumn::Entry>    m_times;   // of the samples in m_raw
+    std::vector<uint32_t>             m_reduced; // min and max of every drawn column
+    std::vector<int>                  m_columns; // pixel column of every pair in m_reduced
+
+    std::shared_ptr<NodeStatistics const> m_statistics;
+    bool                                  m_enabled{true};
+    uint32_t                              m_start_ms{0};
+    float                                 m_ms_per_pixel{0};
+    std::vector<sf::Vertex>               m_curve;
+    std::vector<size_t>                   m_breaks; // indices in m_curve where a line starts after a gap
+    sf::FloatRect                         m_graph_region;
 
     std::string m_name;
     int         m_text_center_pos;
@@ -135,8 +281,6 @@ private:
 
     const int m_margin{20};
 
-    void ConvertData(std::vector<float>& data);
-
     sf::RectangleShape m_background;
     sf::RectangleShape m_chart_region;
     sf::FloatRect      m_chart_rect;
@@ -156,11 +300,27 @@ private:
     std::vector<std::shared_ptr<ChartSignal>> m_chart_signals;
     bool                                      m_draw_all_chart_signals = true;
 
+    // Profiler overlay
+    sf::RectangleShape                    m_profiler_background;
+    sf::Text                              m_profiler_text;
+    bool                                  m_show_profiler{false};
+    std::chrono::steady_clock::time_point m_profiler_last_update;
+
+    // Statistics overlay
+    sf::RectangleShape                    m_statistics_background;
+    sf::Text                              m_statistics_text;
+    bool                                  m_show_statistics{false};
+    std::chrono::steady_clock::time_point m_statistics_last_update;
+
     float m_max_val;
 
     int m_num_of_points;
 
-    int m_sampling_period_ms{0};
+    int m_sampling_period_ms{0}; // shortest period of the loaded devices, a pixel is m_samples_per_pixel of it
+    int m_samples_per_pixel{1};
+
+    uint32_t m_start_ms{0};  // time at the left edge of the chart
+    bool     m_follow{true}; // keep the newest samples in view
 
     bool m_mouseover;
 
@@ -182,7 +342,7 @@ public:
     void AddChartSignal(std::shared_ptr<ChartSignal> const& csignal);
     void ChangeChartSignal(int idx, std::shared_ptr<ChartSignal> const& csignal);
 
-    void Update(std::vector<BaseDevice const*> const& devices);
+    void Update();
     void LoadDevices(std::vector<BaseDevice const*> const& devices);
 
     // n_lines - number of one type of lines (vertical or horizontal), there are same number of other lines
@@ -190,16 +350,30 @@ public:
     void                 CreateAxisMarkers();
     void                 CreateAxisX();
     void                 CreateAxisY();
-    void                 SetAxisX(int startx);
+    void                 SetAxisX(uint32_t start_ms);
+    void                 Scroll(int pixels); // move the view, positive towards newer samples
     const sf::FloatRect& GraphRegion();
     void                 SetDrawChartSignal(int idx, bool on);
     bool                 ToggleDrawChartSignal(int idx);
     bool                 ToggleDrawAllChartSignals();
+    bool                 ToggleProfilerOverlay();
+    void                 UpdateProfilerOverlay();
+    bool                 ToggleStatisticsOverlay();
+    void                 UpdateStatisticsOverlay();
 
     void SetSamplingPeriod(uint32_t sampling_period_ms);
+    // Fit [from_min, to_min] into the chart region, zooming out if it holds more samples than pixels
+    void SetTimeWindow(float from_min, float to_min);
+
+    std::vector<std::shared_ptr<ChartSignal>> const& ChartSignals() const { return m_chart_signals; }
 
     void ClearChartSignals();
 
+private:
+    float MsPerPixel() const { return static_cast<float>(m_sampling_period_ms) * m_samples_per_pixel; }
+    void  UpdateView(); // show all signals from m_start_ms (or the newest samples when following)
+
+public:
     // Actions
     void OnKeyPress(const chart_callback_type& f);
 
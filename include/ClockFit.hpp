@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Serializer.hpp"
+#include <cstdint>
+#include <optional>
+
+// Mapping from the firmware packet id of a device to host time, host_ms = offset + skew * (packet_id - base_id).
+// Every board runs its own oscillator, so the skew (ms per packet) differs a bit from the nominal sampling period and
+// boards drift apart by seconds a day. The mapping is fitted passively with an online linear regression over packet
+// arrival times, the host side latency of single arrivals averages out. A fit covers one acquisition segment, the
+// entries of the time column from Begin() up to the next segment. In capture files it is a 'clock' line per segment:
+// base packet id, offset in ms, skew in ms per packet, number of observations and the first entry it covers.
+class ClockFit : public Serializer
+{
+public:
+    static constexpr uint64_t MinObservations = 8; // before the fit is used
+
+    ClockFit() = default;
+    explicit ClockFit(size_t begin) : m_begin(begin) {}
+
+    virtual ser_data_t Serialize() const override; // nothing if the fit has no observations
+    virtual void       Deserialize(ser_data_t& data) override;
+
+    // Packet packet_id arrived at host_ms. Ids going backwards (firmware restarted counting) start a new fit.
+    void     Add(uint32_t packet_id, double host_ms);
+    bool     Valid() const { return m_n >= MinObservations && m_skew > 0; }
+    double   Map(uint32_t packet_id) const; // host time of packet_id in ms, only meaningful if Valid
+    double   Skew() const { return m_skew; }
+    uint64_t Observations() const { return m_n; }
+    void     Reset();
+
+    std::optional<size_t>   Begin() const { return m_begin; } // not known in captures made before segments were stored
+    std::optional<uint32_t> BaseId() const { return m_base_id; }
+
+private:
+    double X(uint32_t packet_id) const { return static_cast<int32_t>(packet_id - *m_base_id); } // wraps around
+
+    std::optional<size_t>   m_begin;   // first entry of the time column covered by the fit
+    std::optional<uint32_t> m_base_id; // first packet id of the fit, x values are relative to it
+    uint32_t                m_last_id{0};
+    uint64_t                m_n{0};
+    double                  m_mean_x{0}, m_mean_y{0};
+    double                  m_sxx{0}, m_sxy{0}; // co-moments, updated with Welford's method so they don't lose precision
+    double                  m_skew{0};
+    double                  m_offset{0}; // host time at x = 0
+};
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Conversion of raw ADC samples to physical values
+namespace Conversion
+{
+// Raw 12 bit ADC value of the NTC divider to temperature in *C
+float NtcTemperature(float raw);
+
+// Batch version, values within the ADC range come from a precomputed table. The conversion is monotonic
+// (decreasing), so min / max of raw values map to max / min of temperatures.
+void NtcTemperature(const uint32_t* raw, float* out, size_t n);
+} // namespace Conversion
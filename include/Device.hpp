@@ -1,15 +1,20 @@
 #pragma once
 
+#include "ClockFit.hpp"
 #include "Communication.hpp"
+#include "Filters.hpp"
+#include "NodeStatistics.hpp"
+#include "SampleStore.hpp"
 #include "Serializer.hpp"
+#include "TimeColumn.hpp"
+#include <chrono>
+#include <cstring>
 #include <memory>
 #include <optional>
 
 struct DataPacket {
-    static constexpr uint32_t HEADER_START_ID = 0xDEADBEEF;
-
-    static std::optional<DataPacket> Extract(const uint8_t* data, size_t size, int& remaining_size);
-    static std::optional<DataPacket> Extract(std::vector<uint8_t>& data);
+    static constexpr uint32_t HEADER_START_ID  = 0xDEADBEEF;
+    static constexpr uint32_t MAX_PAYLOAD_SIZE = 64 * 1024; // bytes, bigger sizes mean a corrupted header
 
     struct Header {
         uint32_t header_start_id{0};
@@ -17,6 +22,26 @@ struct DataPacket {
         uint32_t packet_id{0};
     };
 
+    // Packet that points into the receive buffer, valid until the buffer changes
+    struct View {
+        Header         header;
+        const uint8_t* payload{nullptr};
+        size_t         payload_len{0}; // number of payload words
+
+        uint32_t operator[](size_t idx) const
+        {
+            uint32_t val;
+            memcpy(&val, payload + idx * sizeof(uint32_t), sizeof(val)); // payload isn't necessarily aligned
+            return val;
+        }
+    };
+
+    // Find the first complete packet in data without copying it. consumed is set to the number of bytes at the
+    // start of data that are not needed anymore (up to the end of the packet, or garbage before an incomplete one).
+    static std::optional<View>       Parse(const uint8_t* data, size_t size, size_t& consumed);
+    static std::optional<DataPacket> Extract(const uint8_t* data, size_t size, int& remaining_size);
+    static std::optional<DataPacket> Extract(std::vector<uint8_t>& data);
+
     Header                header;
     std::vector<uint32_t> payload;
 };
@@ -24,60 +49,112 @@ struct DataPacket {
 class Node : public Serializer
 {
 public:
-    Node(std::string const& name) :
-        m_name(name) {}
+    using Store = SampleStore;
+
+    Node(std::string const& name, SampleWidth width = SampleWidth::Auto) :
+        m_name(name), m_buffer(Store::Create(width)) {}
     Node() {}
-    ~Node() { clear(); }
+    Node(Node const& other) :
+        m_name(other.m_name), m_buffer(other.m_buffer->Clone()), m_statistics(std::make_shared<NodeStatistics>(*other.m_statistics)) {}
+    Node(Node&& other) noexcept = default;
+    Node& operator=(Node const& other)
+    {
+        m_name       = other.m_name;
+        m_buffer     = other.m_buffer->Clone();
+        m_statistics = std::make_shared<NodeStatistics>(*other.m_statistics);
+        return *this;
+    }
+    Node& operator=(Node&& other) noexcept = default;
 
     virtual ser_data_t           Serialize() const override;
     virtual void                 Deserialize(ser_data_t& data) override;
-    const std::vector<uint32_t>& buffer() const { return m_buffer; }
-    void                         push_back(uint32_t data) { m_buffer.push_back(data); }
-    void                         append(std::vector<uint32_t> const& data) { m_buffer.insert(m_buffer.end(), data.begin(), data.end()); }
+    Store const&                 buffer() const { return *m_buffer; }
+    std::shared_ptr<Store const> shared_buffer() const { return m_buffer; }
+    size_t                       resident_bytes() const { return m_buffer->ResidentBytes(); }
+    void                         push_back(uint32_t data) { m_buffer->push_back(data); }
+    void                         append(std::vector<uint32_t> const& data) { m_buffer->append(data); }
+    void                         append_gap(size_t n) { m_buffer->append_gap(n); } // n missing samples
+    void                         sample_width(SampleWidth width); // samples already stored are kept
+    SampleWidth                  sample_width() const { return m_buffer->Width(); }
     void                         name(std::string const& name) { m_name = name; }
     std::string                  name() const { return m_name; }
-    void                         clear() { m_buffer.clear(); }
-    void                         reset()
+    void                         clear()
+    {
+        m_buffer->clear();
+        m_statistics->Clear();
+    }
+    void reset()
     {
         m_name.clear();
-        m_buffer.clear();
+        m_buffer->clear();
+        m_statistics->Clear();
     }
 
+    // Statistics are fed by the acquisition, in converted units
+    NodeStatistics&                       statistics() { return *m_statistics; }
+    std::shared_ptr<NodeStatistics const> shared_statistics() const { return m_statistics; }
+
 private:
-    std::string           m_name;
-    std::vector<uint32_t> m_buffer;
+    std::string                     m_name;
+    std::shared_ptr<Store>          m_buffer{Store::Create(SampleWidth::Auto)};
+    std::shared_ptr<NodeStatistics> m_statistics{std::make_shared<NodeStatistics>()};
 };
 
 class BaseDevice : public Serializer
 {
 public:
+    virtual ~BaseDevice() = default;
+
     virtual ser_data_t Serialize() const override;
     virtual void       Deserialize(ser_data_t& data) override;
 
-    virtual void                     SetID(int id) { m_id = id; }
-    virtual int                      GetID() const { return m_id; }
-    virtual void                     SetName(std::string const& name) { m_name = name; }
-    virtual std::string const&       GetName() const { return m_name; }
-    virtual void                     push_back(Node const& node) { m_nodes.push_back(node); }
-    virtual void                     AssignNodes(std::vector<Node> const& nodes) { m_nodes = nodes; }
-    virtual std::vector<Node> const& GetNodes() const { return m_nodes; }
-    virtual Node const&              GetNode(int idx) const { return m_nodes.at(idx); }
-    virtual void                     Clear()
+    virtual void                              SetID(int id) { m_id = id; }
+    virtual int                               GetID() const { return m_id; }
+    virtual void                              SetName(std::string const& name) { m_name = name; }
+    virtual std::string const&                GetName() const { return m_name; }
+    virtual void                              push_back(Node const& node) { m_nodes.push_back(node); }
+    virtual void                              AssignNodes(std::vector<Node> const& nodes) { m_nodes = nodes; }
+    virtual std::vector<Node> const&          GetNodes() const { return m_nodes; }
+    virtual std::vector<Node>&                GetNodes() { return m_nodes; }
+    virtual Node const&                       GetNode(int idx) const { return m_nodes.at(idx); }
+    virtual void                              SetSampleWidth(SampleWidth width); // applies to existing and later added nodes
+    virtual SampleWidth                       GetSampleWidth() const { return m_sample_width; }
+    // Period of the stored samples, devices may be sampled at different rates. 0 if it isn't known.
+    virtual void                              SetSamplingPeriod(uint32_t period_ms) { m_sampling_period_ms = period_ms; }
+    virtual uint32_t                          GetSamplingPeriod() const { return m_sampling_period_ms; }
+    // Receive time and packet id of every stored sample, empty for captures made before it was recorded
+    virtual TimeColumn const&                 GetTimeColumn() const { return *m_time; }
+    virtual std::shared_ptr<TimeColumn const> SharedTimeColumn() const { return m_time; }
+    // Fitted mappings from packet id to host time, one per acquisition segment. Times of loaded captures are taken from them.
+    virtual std::vector<ClockFit> const&      GetClocks() const { return m_clocks; }
+    virtual void                              Clear()
     {
         for (auto& n : m_nodes)
             n.clear();
+        m_time->clear();
+        m_clocks.clear();
     }
     virtual void Reset()
     {
         m_id = -1;
         m_name.clear();
         m_nodes.clear();
+        m_time->clear();
+        m_clocks.clear();
     }
 
 protected:
-    int               m_id{-1};
-    std::string       m_name;
-    std::vector<Node> m_nodes;
+    void      ApplyClock();
+    void      BeginClockSegment(); // entries appended to the time column from now on get a fit of their own
+    ClockFit& Clock();             // fit of the current segment
+
+    int                         m_id{-1};
+    std::string                 m_name;
+    std::vector<Node>           m_nodes;
+    SampleWidth                 m_sample_width{SampleWidth::Auto};
+    uint32_t                    m_sampling_period_ms{0};
+    std::shared_ptr<TimeColumn> m_time{std::make_shared<TimeColumn>()};
+    std::vector<ClockFit>       m_clocks;
 };
 
 class VirtualDevice : public BaseDevice
@@ -91,18 +168,48 @@ public:
     PhysicalDevice();
     ~PhysicalDevice();
 
-    void SetSamplingPeriod(uint32_t period_ms) const;
+    // SetSamplingPeriod sets the period the device samples at, stored samples are decimation times further apart
+    virtual uint32_t GetSamplingPeriod() const override;
+    uint32_t         GetHardwarePeriod() const { return m_sampling_period_ms; }
+    void             SendSamplingPeriod(); // configure the connected device
+
+    void SetTimeOrigin(std::chrono::steady_clock::time_point origin); // receive times are stored relative to it
     void Start();
     void Stop();
     bool TryConnect();
     void Disconnect();
+    void Drop(); // forget a connection that failed, without talking to the device
+    bool IsConnected() const { return m_connected; }
+    bool IsRunning() const { return m_running; }
+
+    std::string const& GetPort() const { return m_port; } // of the last connection, e.g. /dev/ttyACM0
     int  ReadData();
 
-private:
-    std::shared_ptr<Communication> m_serial_socket;
+    // Same configuration (id, name, nodes, sample width, sampling period and filter), so its connection and samples
+    // can be kept when the configuration is read again
+    bool SameConfig(PhysicalDevice const& other) const;
 
-    std::vector<uint8_t> m_raw_buffer;
-    std::optional<int>   m_prev_packet_id;
-    bool                 m_connected{false};
-    bool                 m_running{false};
+    // Filtering between packet extraction and storage
+    void                  SetFilter(FilterSettings const& settings);
+    FilterSettings const& GetFilterSettings() const { return m_filter_settings; }
+    std::vector<uint32_t> RawHistory(int node) const; // raw samples kept before filtering, oldest first
+
+private:
+    size_t StoreColumns();
+    void   StoreGap(uint32_t missed);
+
+    std::shared_ptr<Communication>        m_serial_socket;
+
+    std::vector<uint8_t>                  m_raw_buffer; // received bytes not yet parsed into packets
+    std::vector<DataPacket::View>         m_packets;    // packets of one read, pointing into m_raw_buffer
+    std::vector<std::vector<uint32_t>>    m_columns;    // samples of one read transposed per node, then receive time and packet id
+    FilterSettings                        m_filter_settings;
+    std::unique_ptr<DeviceFilter>         m_filter;
+    std::optional<uint32_t>               m_prev_packet_id;
+    std::chrono::steady_clock::time_point m_time_origin{std::chrono::steady_clock::now()};
+    int64_t                               m_last_time_ms{0}; // receive time of the last packet
+    std::string                           m_port;
+    bool                                  m_connected{false};
+    bool                                  m_running{false};
+    bool                                  m_outage{false}; // dropped while running, the next packet closes it with a gap
 };
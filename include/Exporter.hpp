@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class BaseDevice;
+
+// Export of captured samples to other tools
+namespace Exporter
+{
+// Samples of all devices on one time axis: one row per receive time with the packet id and the converted values of
+// the selected nodes (all if empty) of every device that has a sample at that time, the cells of the other devices
+// are empty. Devices sampled at different rates are merged, not resampled. Samples without a receive time (captures
+// made before times were recorded) are placed at index * sampling period of their device. Gaps (missed packets) are
+// written as NaN. Returns false if the file can't be written.
+bool WriteCsv(std::vector<BaseDevice const*> const& devices, std::string const& fname, std::vector<std::string> const& nodes = {});
+} // namespace Exporter
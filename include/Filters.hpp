@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct FilterSettings {
+    int    median{1};     // window of the spike filter: 1 (off), 3 or 5
+    int    decimation{1}; // store the average of every n samples
+    size_t raw_ring{0};   // number of raw samples per node kept for debugging, 0 - off
+
+    bool Enabled() const { return median > 1 || decimation > 1 || raw_ring > 0; }
+    bool operator==(FilterSettings const& other) const { return median == other.median && decimation == other.decimation && raw_ring == other.raw_ring; }
+    bool operator!=(FilterSettings const& other) const { return !(*this == other); }
+};
+
+// Kernels work on one node's samples. The medians use SSE4.1 if the CPU has it (x86, checked once at startup), the
+// scalar versions are written branch free, so they can be vectorized too.
+namespace Kernels
+{
+// out[i] = median of in[i .. i + 2], in has n + 2 samples
+void Median3(const uint32_t* in, uint32_t* out, size_t n);
+void Median3Scalar(const uint32_t* in, uint32_t* out, size_t n);
+// out[i] = median of in[i .. i + 4], in has n + 4 samples
+void Median5(const uint32_t* in, uint32_t* out, size_t n);
+void Median5Scalar(const uint32_t* in, uint32_t* out, size_t n);
+// Rounded average of every factor samples, returns number of averages written (only complete groups)
+size_t DecimateAverage(const uint32_t* in, size_t n, int factor, uint32_t* out);
+} // namespace Kernels
+
+// Processing stage between packet extraction and storage of a device. Works in place on the per node columns of
+// one read; history needed across reads (median window, incomplete decimation group) is kept per node. Columns after
+// the node ones (receive times, packet ids) aren't filtered, they keep the sample that completes every decimation group.
+class DeviceFilter
+{
+public:
+    DeviceFilter(FilterSettings const& settings);
+
+    void                  Process(std::vector<std::vector<uint32_t>>& columns, size_t nodes); // first nodes columns are samples
+    void                  Reset();                             // forget history, e.g. after the device was restarted
+    std::vector<uint32_t> RawHistory(size_t node) const;       // oldest first
+    FilterSettings const& Settings() const { return m_settings; }
+
+private:
+    struct NodeState {
+        std::array<uint32_t, 4> history{}; // last median window - 1 samples
+        bool                    primed{false};
+        uint64_t                sum{0}; // incomplete decimation group
+        int                     count{0};
+        std::vector<uint32_t>   ring;
+        size_t                  ring_pos{0};
+        bool                    ring_full{false};
+        std::vector<uint32_t>   scratch;
+    };
+
+    void Median(NodeState& state, std::vector<uint32_t>& column);
+    void Decimate(NodeState& state, std::vector<uint32_t>& column);
+    void KeepRaw(NodeState& state, std::vector<uint32_t> const& column);
+    void Pick(NodeState& state, std::vector<uint32_t>& column);
+
+    FilterSettings         m_settings;
+    std::vector<NodeState> m_nodes;
+};
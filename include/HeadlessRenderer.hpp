@@ -0,0 +1,46 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace sf
+{
+class RenderTexture;
+}
+class Chart;
+
+struct HeadlessOptions {
+    std::vector<std::string> files;   // capture files, directories are expanded to the .txt files they contain
+    std::vector<std::string> nodes;   // nodes to draw, empty means all
+    std::optional<float>     from_min; // time window in minutes
+    std::optional<float>     to_min;
+    std::string              out_dir{"."};
+    int                      width{1230};
+    int                      height{660};
+    int                      jobs{0}; // 0 - use all cores
+    bool                     stats{false}; // also write node statistics to <name>_stats.csv
+    bool                     csv{false};   // also write samples of all devices to <name>.csv
+};
+
+// Renders capture files to PNG images without opening a window. Files are distributed over worker threads
+// and every worker owns its render texture (and with it its own OpenGL context).
+class HeadlessRenderer
+{
+public:
+    HeadlessRenderer(HeadlessOptions const& options);
+
+    // Returns std::nullopt if '--headless' is not among the arguments, throws std::invalid_argument on malformed arguments
+    static std::optional<HeadlessOptions> ParseArguments(int argc, char* argv[]);
+    static std::string                    Usage();
+
+    int Run(); // returns number of files that failed to render
+
+private:
+    bool        RenderFile(size_t file, sf::RenderTexture& texture) const;
+    std::string OutputName(size_t file, std::string const& suffix = ".png") const;
+    bool        WriteStatistics(::Chart const& chart, size_t file) const;
+
+    HeadlessOptions          m_options;
+    std::vector<std::string> m_out_names; // per file, unique even if files of different directories share a name
+};
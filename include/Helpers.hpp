@@ -27,10 +27,9 @@ template <class T>
 inline T& operator^=(T& a, T b) { return (T&)((int&)a ^= (int)b); }
 */
 
+// Running statistics (Welford), no history is kept
 template <typename T>
 struct Statistics {
-    std::vector<T> buffer;
-
     // min is special since when uninitialized no value makes real sense
     std::optional<T> min;
 
@@ -41,15 +40,13 @@ struct Statistics {
     T cnt;
     T sum;
 
-    Statistics(size_t history_size = 1000)
+    Statistics()
     {
-        buffer.reserve(history_size);
         Clear();
     }
 
     void Clear()
     {
-        buffer.clear();
         min = std::nullopt;
         max = avg = prev_avg = stdev = S = last = cnt = sum = static_cast<T>(0);
     }
@@ -71,8 +68,6 @@ struct Statistics {
         avg      = sum / cnt;
         S        = S + (val - avg) * (val - prev_avg);
         stdev    = static_cast<T>(std::sqrt(S / cnt));
-
-        buffer.push_back(val);
     }
 };
 
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Watches /dev for serial ports of USB boards (ttyACM*, ttyUSB*) appearing and disappearing, e.g. when a board resets
+// mid-run and enumerates again. Uses inotify, so Poll is a single non-blocking read. On other platforms, or if
+// inotify isn't available, nothing is ever reported.
+class HotplugWatcher
+{
+public:
+    struct Event {
+        bool        added; // false - removed
+        std::string port;  // full path, e.g. /dev/ttyACM0
+    };
+
+    HotplugWatcher();
+    ~HotplugWatcher();
+    HotplugWatcher(HotplugWatcher const&) = delete;
+    HotplugWatcher& operator=(HotplugWatcher const&) = delete;
+
+    bool               Valid() const { return m_fd >= 0; }
+    std::vector<Event> Poll(); // events since the last call
+
+private:
+    int m_fd{-1};
+};
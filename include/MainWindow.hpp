@@ -2,13 +2,13 @@
 
 #include <mygui/Action.hpp>
 #include <mygui/Button.hpp>
-#include <mygui/Checkbox.hpp>
 #include <mygui/Textbox.hpp>
 
 #include <lsignal.hpp>
 
 #include "Chart.hpp"
 #include "Device.hpp"
+#include "SignalList.hpp"
 #include "Window.hpp"
 
 class MainWindow : public Window
@@ -21,6 +21,8 @@ private:
     long long                  m_total_run_time{0};
     long long                  m_alive_start{0};
 
+    std::chrono::steady_clock::time_point m_signal_list_refresh;
+
     // Widgets
     //////////
 
@@ -41,8 +43,8 @@ private:
     // Select all / Deselect all checkboxes button
     std::shared_ptr<mygui::Button> button_sel_desel_all_chkbxs;
 
-    // Checkboxes to enable/disable drawing of signals
-    std::vector<std::shared_ptr<mygui::Checkbox>> checkboxes_signal_enabled;
+    // List of signals with checkboxes to enable/disable drawing of signals
+    std::shared_ptr<SignalList> signal_list;
 
     // Actions
     std::shared_ptr<mygui::Action> action_update_titlebar;
@@ -56,6 +58,9 @@ private:
     // Private functions
     void UpdateTitleBar();
 
+protected:
+    virtual void Draw() override;
+
 public:
     // Methods
     MainWindow();
@@ -74,4 +79,5 @@ public:
     lsignal::signal<void()>                   signal_button_save_Clicked;
     lsignal::signal<void(std::string const&)> signal_button_load_Clicked;
     lsignal::signal<void()>                   signal_button_clear_Clicked;
+    lsignal::signal<void()>                   signal_reconnect_requested;
 };
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <thread>
+
+// Makes the profiler's metrics (Profiler::Prometheus) available to a Prometheus scraper, on its own thread: served
+// over HTTP on http://127.0.0.1:<port>/metrics and/or written to a file every interval (replaced atomically, so it
+// works with the node exporter's textfile collector). Nothing on the hot paths waits for it.
+class MetricsExporter
+{
+public:
+    struct Settings {
+        std::optional<uint16_t> port; // 0 - any free port
+        std::string             file; // empty - no file
+        uint32_t                interval_ms{10 * 1000};
+
+        bool operator==(Settings const& other) const { return port == other.port && file == other.file && interval_ms == other.interval_ms; }
+    };
+
+    explicit MetricsExporter(Settings const& settings); // throws std::runtime_error if it can't listen
+    ~MetricsExporter();
+    MetricsExporter(MetricsExporter const&) = delete;
+    MetricsExporter& operator=(MetricsExporter const&) = delete;
+
+    Settings const& GetSettings() const { return m_settings; }
+    uint16_t        Port() const { return m_port; } // the one listened on
+
+private:
+    void Loop();
+    void Serve(intptr_t client) const;
+    void Dump() const;
+
+    Settings          m_settings;
+    intptr_t          m_listen{-1};
+    uint16_t          m_port{0};
+    std::atomic<bool> m_stop{false};
+    std::thread       m_thread;
+};
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "TimeColumn.hpp"
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Min, max and mean of the samples received in the last Length() milliseconds. Samples are aggregated into
+// Buckets time buckets (min, max, sum), so memory doesn't depend on the sample rate and an update is O(1). The window
+// follows the receive time of the newest sample or gap and is exact to one bucket, 1/Buckets of its length.
+class SlidingWindow
+{
+public:
+    static constexpr size_t Buckets = 60;
+
+    SlidingWindow(uint32_t length_ms = 1000);
+
+    void     Update(uint32_t time_ms, float val);
+    void     Advance(uint32_t time_ms); // nothing was received until time_ms, older buckets fall out of the window
+    void     Clear();
+    uint32_t Length() const { return m_width * static_cast<uint32_t>(Buckets); }
+    size_t   Count() const; // samples currently in the window
+    float    Min() const;
+    float    Max() const;
+    double   Mean() const;
+
+private:
+    struct Bucket {
+        uint32_t count{0};
+        float    min{0};
+        float    max{0};
+        double   sum{0};
+    };
+
+    uint32_t            m_width;     // ms
+    std::vector<Bucket> m_buckets;   // ring, bucket number i (time / width) is at i % Buckets
+    uint64_t            m_newest{0}; // bucket number of the newest sample or gap
+};
+
+// Statistics of one node, updated in batches as samples are ingested: whole run moments (Welford, no history)
+// and any number of sliding windows over receive time. Reading them never scans the samples. All methods are thread
+// safe.
+class NodeStatistics
+{
+public:
+    struct WindowSummary {
+        std::string name;
+        size_t      count{0};
+        float       min{0};
+        float       max{0};
+        double      mean{0};
+    };
+
+    struct Summary {
+        uint64_t                   count{0};
+        float                      min{0};
+        float                      max{0};
+        double                     mean{0};
+        double                     stdev{0};
+        std::vector<WindowSummary> windows;
+    };
+
+    NodeStatistics() = default;
+    NodeStatistics(NodeStatistics const& other);
+
+    // Name and length in ms of every window, all statistics are restarted
+    void     Configure(std::vector<std::pair<std::string, uint32_t>> const& windows);
+    bool     Configured() const;
+    void     Update(const float* data, TimeColumn::Entry const* times, size_t n); // times - receive times of the samples
+    void     Skip(size_t n, uint32_t time_ms); // n missing samples, the last received at time_ms, they only advance the position and time
+    void     Clear();
+    uint64_t Count() const;    // number of samples seen
+    uint64_t Position() const; // number of samples seen or skipped
+    Summary  Get() const;
+
+    // "1min" -> 60000, valid units are ms, s (default), min and h. Throws std::invalid_argument.
+    static uint32_t ParseDuration(std::string const& str);
+
+private:
+    mutable std::mutex m_mtx;
+    bool               m_configured{false};
+
+    uint64_t m_count{0};
+    uint64_t m_position{0};
+    double   m_mean{0};
+    double   m_m2{0}; // sum of squared differences from the mean
+    float    m_min{0};
+    float    m_max{0};
+
+    std::vector<std::string>   m_window_names;
+    std::vector<SlidingWindow> m_windows;
+};
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Always-on instrumentation of the hot paths. Every stage records its duration into a log-linear histogram
+// and counters accumulate events. Tick() (once per frame) rolls everything into one second windows which is
+// what the summaries, rates and the chart overlay report. Totals since the start are exported for Prometheus.
+class Profiler
+{
+public:
+    enum class Stage { SerialRead, PacketExtract, Conversion, CurveRebuild, Draw, Save, Count };
+
+    enum class Counter { Packets, Bytes, MissedPackets, IngestAllocations, DeviceFailures, Count };
+
+    enum class Gauge { BufferBytes, BufferBudgetBytes, SpilledBytes, ConnectedDevices, Count };
+
+    // Histogram of durations in ns. Each power of two is split into 4 sub buckets, so reported percentiles
+    // are within 25 % of the real value, which is plenty for spotting stalls.
+    class Histogram
+    {
+    public:
+        static constexpr int SubBits    = 2;
+        static constexpr int NumBuckets = 64 << SubBits;
+
+        void     Record(uint64_t ns);
+        void     Clear();
+        void     CopyFrom(Histogram const& other);
+        uint64_t Percentile(double p) const;
+        uint64_t CountBelow(uint64_t ns) const; // recorded durations below ns, exact for powers of two
+        uint64_t Max() const { return m_max.load(std::memory_order_relaxed); }
+        uint64_t Count() const { return m_count.load(std::memory_order_relaxed); }
+        uint64_t Sum() const { return m_sum.load(std::memory_order_relaxed); } // of all durations in ns
+
+    private:
+        static int      BucketIndex(uint64_t ns);
+        static uint64_t BucketValue(int idx);
+
+        std::array<std::atomic<uint32_t>, NumBuckets> m_buckets{};
+        std::atomic<uint64_t>                         m_count{0};
+        std::atomic<uint64_t>                         m_sum{0};
+        std::atomic<uint64_t>                         m_max{0};
+    };
+
+    struct StageSummary {
+        uint64_t p50_ns{0};
+        uint64_t p99_ns{0};
+        uint64_t max_ns{0};
+        uint64_t count{0};
+    };
+
+    class ScopedTimer
+    {
+    public:
+        ScopedTimer(Stage stage) :
+            m_stage(stage), m_start(std::chrono::steady_clock::now()) {}
+        ~ScopedTimer()
+        {
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count();
+            Profiler::Get().Record(m_stage, ns);
+        }
+
+    private:
+        Stage                                 m_stage;
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    static Profiler& Get();
+
+    void Record(Stage stage, uint64_t ns)
+    {
+        m_current[static_cast<int>(stage)].Record(ns);
+        m_total[static_cast<int>(stage)].Record(ns);
+    }
+    void Add(Counter counter, uint64_t n = 1) { m_counters[static_cast<int>(counter)].fetch_add(n, std::memory_order_relaxed); }
+    void Set(Gauge gauge, uint64_t val) { m_gauges[static_cast<int>(gauge)].store(val, std::memory_order_relaxed); }
+
+    // Roll the one second windows if due, should be called once per frame
+    void Tick();
+
+    StageSummary Summary(Stage stage) const;
+    double       Rate(Counter counter) const; // per second over the last completed window
+    uint64_t     Total(Counter counter) const { return m_counters[static_cast<int>(counter)].load(std::memory_order_relaxed); }
+    uint64_t     Value(Gauge gauge) const { return m_gauges[static_cast<int>(gauge)].load(std::memory_order_relaxed); }
+
+    std::string Report() const;     // multi-line text used by the overlay
+    std::string Prometheus() const; // totals in the Prometheus text exposition format
+
+    static const char* Name(Stage stage);
+
+private:
+    Profiler();
+
+    static constexpr int NumStages   = static_cast<int>(Stage::Count);
+    static constexpr int NumCounters = static_cast<int>(Counter::Count);
+    static constexpr int NumGauges   = static_cast<int>(Gauge::Count);
+
+    std::array<Histogram, NumStages>               m_current;
+    std::array<Histogram, NumStages>               m_last;
+    std::array<Histogram, NumStages>               m_total; // never cleared
+    std::array<std::atomic<uint64_t>, NumCounters> m_counters{};
+    std::array<uint64_t, NumCounters>              m_counters_at_window_start{};
+    std::array<double, NumCounters>                m_rates{};
+    std::array<std::atomic<uint64_t>, NumGauges>   m_gauges{};
+    std::chrono::steady_clock::time_point          m_window_start;
+};
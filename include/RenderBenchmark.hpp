@@ -0,0 +1,43 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+struct RenderBenchmarkOptions {
+    int nodes{128};       // synthetic signals
+    int samples{100000};  // history of every signal
+    int period_ms{100};   // sampling period of the signals
+    int width{1230};      // of the render target
+    int height{660};
+    int frames{300};      // per phase
+    int append{10};       // samples appended to every signal per frame in the live phase
+    int scroll{8};        // pixels scrolled per frame in the scroll phase
+};
+
+// Measures how chart rendering scales with the number of signals, their history length and the window size. A chart
+// with synthetic signals is drawn offscreen, first scrolled through the whole history (every sample in view) and
+// then following live appends. Frame times include the curve rebuilds and are taken after glFinish, so they are
+// what the GPU (or the software rasterizer) really needed.
+class RenderBenchmark
+{
+public:
+    RenderBenchmark(RenderBenchmarkOptions const& options) :
+        m_options(options) {}
+
+    // Returns std::nullopt if '--render-bench' is not among the arguments, throws std::invalid_argument on malformed arguments
+    static std::optional<RenderBenchmarkOptions> ParseArguments(int argc, char* argv[]);
+    static std::string                           Usage();
+
+    int Run(); // 0 on success
+
+private:
+    struct Frame {
+        double ms;
+        size_t vertices;
+    };
+
+    static void Report(std::string const& phase, std::vector<Frame> frames);
+
+    RenderBenchmarkOptions m_options;
+};
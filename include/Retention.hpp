@@ -0,0 +1,245 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// Interface through which the retention manager evicts blocks of a store
+class Spillable
+{
+public:
+    virtual ~Spillable() = default;
+
+    // Called with Mutex() held. Writes the block to the spill file (if it isn't there yet) and releases its memory.
+    // Returns number of bytes released (0 if the block isn't resident anymore or stamp doesn't match) or std::nullopt
+    // if the block can't be spilled right now (e.g. it is still being written to).
+    virtual std::optional<size_t> Spill(size_t block, uint64_t stamp) = 0;
+    // Called with Mutex() held. Touches the resident blocks again (with 0 bytes, they are counted already), so a budget
+    // set after they became resident can spill them.
+    virtual void        Retouch()     = 0;
+    virtual std::mutex& Mutex() const = 0;
+};
+
+// Keeps resident bytes of all block stores within the configured budget, by spilling least recently used blocks
+// to a spill file. Stores transparently page their blocks back in when they are accessed.
+class Retention
+{
+public:
+    static Retention& Get();
+
+    ~Retention();
+
+    void   SetBudget(size_t bytes); // 0 - unlimited
+    size_t Budget() const;
+    size_t ResidentBytes() const;
+    size_t SpilledBytes() const;
+
+    // "512MB" -> bytes, valid units are B, kB, MB (default) and GB. Throws std::invalid_argument.
+    static size_t ParseSize(std::string const& str);
+
+    // Used by the stores
+    void     Register(Spillable* store);
+    void     Unregister(Spillable* store);
+    uint64_t Touch(Spillable* store, size_t block, size_t bytes); // block became resident, returns its stamp
+    void     Released(size_t bytes);                              // resident bytes freed by the store itself
+    uint64_t Write(const void* data, size_t bytes);               // returns offset in spill file
+    void     Read(uint64_t offset, void* data, size_t bytes);
+    void     Free(uint64_t offset, size_t bytes); // spilled data no longer needed
+    void     Enforce();
+
+private:
+    Retention() = default;
+
+    struct Entry {
+        Spillable* store;
+        size_t     block;
+        uint64_t   stamp;
+    };
+
+    mutable std::recursive_mutex   m_mtx;
+    size_t                         m_budget{0};
+    size_t                         m_resident{0};
+    size_t                         m_spilled{0};
+    uint64_t                       m_next_stamp{0};
+    std::unordered_set<Spillable*> m_stores;
+    std::deque<Entry>              m_lru;           // front is least recently used, only kept with a budget
+    bool                           m_stalled{false}; // nothing in m_lru could be spilled, until something is touched
+
+    std::string                             m_spill_fname;
+    std::fstream                            m_spill_file;
+    uint64_t                                m_spill_end{0};
+    std::map<size_t, std::vector<uint64_t>> m_free_slots; // slot size -> offsets
+};
+
+// Append-only sample storage made of fixed size blocks. Full blocks may be spilled to disk by the retention
+// manager and are paged back in on access. All methods are thread safe.
+template <typename T>
+class BlockStore : public Spillable
+{
+public:
+    static constexpr size_t BlockSize = 4096; // samples per block
+
+    BlockStore() { Retention::Get().Register(this); }
+    BlockStore(BlockStore const& other) :
+        BlockStore()
+    {
+        std::vector<T> buf(BlockSize);
+        for (size_t i = 0, n; (n = other.Read(i, buf.size(), buf.data())) > 0; i += n)
+            append(buf.data(), n);
+    }
+    BlockStore& operator=(BlockStore const&) = delete;
+    ~BlockStore()
+    {
+        Retention::Get().Unregister(this);
+        clear();
+    }
+
+    size_t size() const
+    {
+        std::scoped_lock<std::mutex> sl(m_mtx);
+        return m_size;
+    }
+    bool empty() const { return size() == 0; }
+
+    void push_back(T val) { append(&val, 1); }
+    // Samples of other types are converted while copying them into the blocks
+    template <typename U>
+    void append(const U* data, size_t n)
+    {
+        {
+            std::scoped_lock<std::mutex> sl(m_mtx);
+            while (n > 0) {
+                if (m_blocks.empty() || m_blocks.back().count == BlockSize)
+                    NewBlock();
+                auto&  b = m_blocks.back();
+                size_t k = std::min(n, BlockSize - b.count);
+                std::transform(data, data + k, &b.data[b.count], [](U v) { return static_cast<T>(v); });
+                b.count += k;
+                m_size += k;
+                data += k;
+                n -= k;
+            }
+        }
+        Retention::Get().Enforce();
+    }
+    template <typename U>
+    void append(std::vector<U> const& data)
+    {
+        append(data.data(), data.size());
+    }
+
+    // Copy (and convert) up to n samples starting at begin to out, returns number of samples copied
+    template <typename U>
+    size_t Read(size_t begin, size_t n, U* out) const
+    {
+        size_t copied = 0;
+        {
+            std::scoped_lock<std::mutex> sl(m_mtx);
+            if (begin >= m_size)
+                return 0;
+            n = std::min(n, m_size - begin);
+            while (copied < n) {
+                size_t   idx = begin + copied;
+                size_t   off = idx % BlockSize;
+                size_t   k   = std::min(n - copied, BlockSize - off);
+                const T* d   = Resident(idx / BlockSize);
+                std::transform(d + off, d + off + k, out + copied, [](T v) { return static_cast<U>(v); });
+                copied += k;
+            }
+        }
+        Retention::Get().Enforce();
+        return copied;
+    }
+
+    T operator[](size_t idx) const
+    {
+        T val{};
+        Read(idx, 1, &val);
+        return val;
+    }
+
+    void clear()
+    {
+        std::scoped_lock<std::mutex> sl(m_mtx);
+        auto&                        retention = Retention::Get();
+        for (auto& b : m_blocks) {
+            if (b.data)
+                retention.Released(BlockBytes);
+            if (b.spill_offset)
+                retention.Free(*b.spill_offset, BlockBytes);
+        }
+        m_blocks.clear();
+        m_size = 0;
+    }
+
+    size_t ResidentBytes() const
+    {
+        std::scoped_lock<std::mutex> sl(m_mtx);
+        return std::count_if(m_blocks.begin(), m_blocks.end(), [](Block const& b) { return b.data != nullptr; }) * BlockBytes;
+    }
+
+    virtual std::optional<size_t> Spill(size_t block, uint64_t stamp) override
+    {
+        if (block >= m_blocks.size() || !m_blocks[block].data || m_blocks[block].stamp != stamp)
+            return 0;
+        if (block == m_blocks.size() - 1) // still being written to
+            return std::nullopt;
+
+        auto& b = m_blocks[block];
+        // Full blocks never change, so once written their spilled copy stays valid
+        if (!b.spill_offset)
+            b.spill_offset = Retention::Get().Write(b.data.get(), BlockBytes);
+        b.data.reset();
+        return BlockBytes;
+    }
+
+    virtual void Retouch() override
+    {
+        for (size_t i = 0; i < m_blocks.size(); ++i)
+            if (m_blocks[i].data)
+                m_blocks[i].stamp = Retention::Get().Touch(this, i, 0);
+    }
+
+    virtual std::mutex& Mutex() const override { return m_mtx; }
+
+private:
+    static constexpr size_t BlockBytes = BlockSize * sizeof(T);
+
+    struct Block {
+        std::unique_ptr<T[]>    data;
+        size_t                  count{0};
+        std::optional<uint64_t> spill_offset;
+        uint64_t                stamp{0};
+    };
+
+    void NewBlock()
+    {
+        auto& b = m_blocks.emplace_back();
+        b.data.reset(new T[BlockSize]);
+        b.stamp = Retention::Get().Touch(this, m_blocks.size() - 1, BlockBytes);
+    }
+
+    // Page block in if it was spilled
+    const T* Resident(size_t block) const
+    {
+        auto& b = m_blocks[block];
+        if (!b.data) {
+            b.data.reset(new T[BlockSize]);
+            Retention::Get().Read(*b.spill_offset, b.data.get(), BlockBytes);
+            b.stamp = Retention::Get().Touch(const_cast<BlockStore*>(this), block, BlockBytes);
+        }
+        return b.data.get();
+    }
+
+    mutable std::mutex         m_mtx;
+    mutable std::vector<Block> m_blocks;
+    size_t                     m_size{0};
+};
@@ -0,0 +1,288 @@
+#pragma once
+
+#include "Retention.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Type in which samples of a node are stored. Auto starts with 16 bits and widens the store when a value doesn't fit.
+enum class SampleWidth { U16, U32, F32, Auto };
+
+SampleWidth ParseSampleWidth(std::string const& str); // "u16", "u32", "f32" or "auto", throws std::invalid_argument
+std::string SampleWidthName(SampleWidth width);
+
+// Gaps (runs of missing samples, e.g. of missed packets) of a store. They are kept apart from the samples, one
+// entry per run, and map indices of the store (which count missing samples) to indices of the stored samples.
+// All methods are thread safe.
+class GapIndex
+{
+public:
+    struct Run {
+        size_t begin; // index in the store
+        size_t length;
+    };
+
+    GapIndex() = default;
+    GapIndex(GapIndex const& other);
+
+    void             Add(size_t begin, size_t n); // begin is the current size of the store
+    size_t           Total() const;               // number of missing samples
+    std::vector<Run> Runs() const;
+    void             clear();
+    size_t           ResidentBytes() const;
+
+    // Splits [begin, begin + n) of the store into consecutive parts, calling present(stored_begin, k, offset) for
+    // parts with samples and missing(k, offset) for gaps. offset is the position of the part within the range.
+    template <typename P, typename M>
+    void Split(size_t begin, size_t n, P&& present, M&& missing) const
+    {
+        std::scoped_lock<std::mutex> sl(m_mtx);
+
+        auto   it     = std::upper_bound(m_runs.begin(), m_runs.end(), begin, [](size_t idx, Entry const& e) { return idx < e.run.begin + e.run.length; });
+        size_t pos    = begin, end = begin + n;
+        size_t before = it == m_runs.end() ? m_total : it->before;
+        for (; it != m_runs.end() && pos < end; ++it) {
+            auto const& r = it->run;
+            if (pos < r.begin) {
+                auto k = std::min(end, r.begin) - pos;
+                present(pos - it->before, k, pos - begin);
+                pos += k;
+            }
+            if (pos < end) {
+                auto k = std::min(end, r.begin + r.length) - pos;
+                missing(k, pos - begin);
+                pos += k;
+            }
+            before = it->before + r.length;
+        }
+        if (pos < end)
+            present(pos - before, end - pos, pos - begin);
+    }
+
+private:
+    struct Entry {
+        Run    run;
+        size_t before; // missing samples before the run
+    };
+
+    mutable std::mutex m_mtx;
+    std::vector<Entry> m_runs;
+    size_t             m_total{0};
+};
+
+// Type erased sample storage, samples are appended and read as uint32_t or float no matter how they are stored.
+// Missing samples are stored as runs and read as Missing (NaN as float). All methods are thread safe.
+class SampleStore
+{
+public:
+    static constexpr size_t   BlockSize = BlockStore<uint32_t>::BlockSize; // convenient chunk size for reading
+    static constexpr uint32_t Missing   = std::numeric_limits<uint32_t>::max();
+
+    static std::unique_ptr<SampleStore> Create(SampleWidth width);
+    static void                         Copy(SampleStore const& from, SampleStore& to); // appends all samples of from to to
+
+    virtual ~SampleStore() = default;
+
+    virtual SampleWidth                  Width() const                                     = 0; // never Auto, it is the current width
+    virtual size_t                       size() const                                      = 0;
+    virtual void                         append(const uint32_t* data, size_t n)            = 0;
+    virtual void                         append(const float* data, size_t n)               = 0;
+    virtual size_t                       Read(size_t begin, size_t n, uint32_t* out) const = 0;
+    virtual size_t                       Read(size_t begin, size_t n, float* out) const    = 0;
+    virtual void                         clear()                                           = 0;
+    virtual size_t                       ResidentBytes() const                             = 0;
+    virtual std::unique_ptr<SampleStore> Clone() const                                     = 0;
+    virtual void                         append_gap(size_t n)                              = 0; // n missing samples, stored as one run
+    virtual std::vector<GapIndex::Run>   Gaps() const                                      = 0;
+
+    bool empty() const { return size() == 0; }
+    void push_back(uint32_t val) { append(&val, 1); }
+
+    template <typename U>
+    static U MissingValue()
+    {
+        if constexpr (std::is_floating_point_v<U>)
+            return std::numeric_limits<U>::quiet_NaN();
+        else
+            return static_cast<U>(Missing);
+    }
+    template <typename U>
+    void append(std::vector<U> const& data)
+    {
+        append(data.data(), data.size());
+    }
+};
+
+template <typename T>
+class TypedSampleStore : public SampleStore
+{
+public:
+    using SampleStore::append;
+
+    virtual SampleWidth Width() const override
+    {
+        if constexpr (std::is_same_v<T, uint16_t>)
+            return SampleWidth::U16;
+        else if constexpr (std::is_same_v<T, uint32_t>)
+            return SampleWidth::U32;
+        else
+            return SampleWidth::F32;
+    }
+
+    virtual size_t size() const override { return m_store.size() + m_gaps.Total(); }
+    virtual void   append(const uint32_t* data, size_t n) override { Append(data, n); }
+    virtual void   append(const float* data, size_t n) override { Append(data, n); }
+    virtual size_t Read(size_t begin, size_t n, uint32_t* out) const override { return ReadAround(begin, n, out); }
+    virtual size_t Read(size_t begin, size_t n, float* out) const override { return ReadAround(begin, n, out); }
+    virtual void   clear() override
+    {
+        m_store.clear();
+        m_gaps.clear();
+    }
+    virtual size_t ResidentBytes() const override { return m_store.ResidentBytes() + m_gaps.ResidentBytes(); }
+
+    virtual std::unique_ptr<SampleStore> Clone() const override { return std::make_unique<TypedSampleStore>(*this); }
+
+    virtual void                       append_gap(size_t n) override { m_gaps.Add(size(), n); }
+    virtual std::vector<GapIndex::Run> Gaps() const override { return m_gaps.Runs(); }
+
+private:
+    // Stored samples are read between the gaps, gaps are filled with MissingValue
+    template <typename U>
+    size_t ReadAround(size_t begin, size_t n, U* out) const
+    {
+        auto total = size();
+        if (begin >= total)
+            return 0;
+        n = std::min(n, total - begin);
+        m_gaps.Split(
+            begin, n, [&](size_t stored, size_t k, size_t offset) { m_store.Read(stored, k, out + offset); },
+            [&](size_t k, size_t offset) { std::fill_n(out + offset, k, MissingValue<U>()); });
+        return n;
+    }
+
+    // Missing samples in the data (NaN, Missing) are stored as gaps, like append_gap ones, so they are read as
+    // Missing whatever the width. Converting them would be undefined (NaN to an integer) or lose them (saturated).
+    template <typename U>
+    void Append(const U* data, size_t n)
+    {
+        if (!HasMissing(data, n)) {
+            AppendPresent(data, n);
+            return;
+        }
+        for (size_t i = 0, end; i < n; i = end) {
+            bool missing = IsMissing(data[i]);
+            for (end = i + 1; end < n && IsMissing(data[end]) == missing;)
+                ++end;
+            if (missing)
+                append_gap(end - i);
+            else
+                AppendPresent(data + i, end - i);
+        }
+    }
+
+    template <typename U>
+    void AppendPresent(const U* data, size_t n)
+    {
+        // Values that don't fit are saturated, narrowing of the rest happens while copying into the blocks
+        if constexpr (std::is_integral_v<T> && (std::is_floating_point_v<U> || sizeof(U) > sizeof(T))) {
+            constexpr U lo = 0;
+            const U     hi = Highest<U>();
+            if (!Fits(data, n, lo, hi)) {
+                if (!m_warned) {
+                    std::cout << "Sample out of range of " << SampleWidthName(Width()) << " storage, saturating it\n";
+                    m_warned = true;
+                }
+                m_clamped.resize(n);
+                std::transform(data, data + n, m_clamped.begin(), [&](U v) { return static_cast<T>(std::clamp(v, lo, hi)); });
+                m_store.append(m_clamped.data(), n);
+                return;
+            }
+        }
+        m_store.append(data, n);
+    }
+
+    // Largest U that converts to T. The maximum of a wide T rounds up to 2^digits in a float, which doesn't fit.
+    template <typename U>
+    static U Highest()
+    {
+        if constexpr (std::is_floating_point_v<U>) {
+            U limit = std::ldexp(U{1}, std::numeric_limits<T>::digits); // exact, one past the maximum of T
+            U hi    = static_cast<U>(std::numeric_limits<T>::max());
+            return hi < limit ? hi : std::nextafter(limit, U{0});
+        } else {
+            return static_cast<U>(std::numeric_limits<T>::max());
+        }
+    }
+
+    template <typename U>
+    static bool IsMissing(U v)
+    {
+        if constexpr (std::is_floating_point_v<U>)
+            return std::isnan(v);
+        else
+            return v == MissingValue<U>();
+    }
+
+    template <typename U>
+    static bool HasMissing(const U* data, size_t n)
+    {
+        // No early exit, so the compiler vectorizes it
+        bool any = false;
+        for (size_t i = 0; i < n; ++i)
+            any |= IsMissing(data[i]);
+        return any;
+    }
+
+    template <typename U>
+    static bool Fits(const U* data, size_t n, U lo, U hi)
+    {
+        // Plain min / max reduction, which the compiler vectorizes
+        U min = lo, max = lo;
+        for (size_t i = 0; i < n; ++i) {
+            min = data[i] < min ? data[i] : min;
+            max = data[i] > max ? data[i] : max;
+        }
+        return min >= lo && max <= hi;
+    }
+
+    BlockStore<T>  m_store;
+    GapIndex       m_gaps;
+    std::vector<T> m_clamped;
+    bool           m_warned{false};
+};
+
+// Starts with the narrowest store and moves samples to a wider one on the first value that doesn't fit
+class AutoSampleStore : public SampleStore
+{
+public:
+    using SampleStore::append;
+
+    AutoSampleStore();
+    AutoSampleStore(AutoSampleStore const& other);
+
+    virtual SampleWidth                  Width() const override;
+    virtual size_t                       size() const override;
+    virtual void                         append(const uint32_t* data, size_t n) override;
+    virtual void                         append(const float* data, size_t n) override;
+    virtual size_t                       Read(size_t begin, size_t n, uint32_t* out) const override;
+    virtual size_t                       Read(size_t begin, size_t n, float* out) const override;
+    virtual void                         clear() override;
+    virtual size_t                       ResidentBytes() const override;
+    virtual std::unique_ptr<SampleStore> Clone() const override;
+    virtual void                         append_gap(size_t n) override;
+    virtual std::vector<GapIndex::Run>   Gaps() const override;
+
+private:
+    void Widen(SampleWidth width);
+
+    mutable std::mutex           m_mtx;
+    std::unique_ptr<SampleStore> m_store;
+};
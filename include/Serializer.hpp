@@ -1,5 +1,8 @@
 #pragma once
 
+#include <iomanip>
+#include <limits>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -20,6 +23,11 @@ protected:
         if constexpr (std::is_integral_v<T>) {
             auto str = std::to_string(in) + delim;
             data.insert(it, str.begin(), str.end());
+        } else if constexpr (std::is_floating_point_v<T>) {
+            std::ostringstream ss;
+            ss << std::setprecision(std::numeric_limits<T>::max_digits10) << in << delim;
+            auto str = ss.str();
+            data.insert(it, str.begin(), str.end());
         } else if constexpr (std::is_same_v<std::decay_t<T>, char*>) {
             // char array
             auto str = std::string(in) + delim;
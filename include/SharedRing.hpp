@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Live samples of all devices in a POSIX shared memory ring, so processes on the same host can read them without
+// copies or system calls. One writer (Acquisition), any number of readers. Every device has its own ring of the
+// newest samples in columns: receive times and packet ids, then the temperatures of every node. The writer first
+// announces the sample sequence number it is writing up to, then writes the samples and then publishes them. Readers
+// take a window of published samples, read it in place and check afterwards that the writer didn't overwrite it
+// meanwhile (like a seqlock). Readers only depend on this header and SharedRing.cpp.
+namespace SharedRing
+{
+struct Device {
+    int32_t                  id;
+    uint32_t                 period_ms;
+    std::string              name;
+    std::vector<std::string> nodes;
+    size_t                   capacity; // samples kept in the ring
+
+    bool operator==(Device const& other) const { return id == other.id && period_ms == other.period_ms && name == other.name && nodes == other.nodes && capacity == other.capacity; }
+};
+
+struct Time {
+    uint32_t time_ms;   // host receive time since the start of the acquisition
+    uint32_t packet_id; // firmware packet id
+};
+
+// n values of a window, in two pieces when it wraps around the end of the ring
+template <typename T>
+struct Span {
+    T const* first;
+    size_t   first_size;
+    T const* second;
+    size_t   size;
+
+    T const& operator[](size_t i) const { return i < first_size ? first[i] : second[i - first_size]; }
+};
+
+// Layout of the shared memory, all offsets are from the start of it. Segment header, then a DeviceHeader per device,
+// then names, times and values of every device.
+struct Header {
+    std::atomic<uint32_t> magic; // written last, a reader never sees a half initialized ring
+    uint32_t              version;
+    uint64_t              size; // bytes
+    uint32_t              devices;
+    std::atomic<uint32_t> closed; // the writer is gone or reconfigured, readers have to open the ring again
+};
+
+struct alignas(64) DeviceHeader {
+    std::atomic<uint64_t> writing;   // samples with sequence numbers below this are being written or done
+    std::atomic<uint64_t> published; // samples with sequence numbers below this can be read
+    int32_t               id;
+    uint32_t              period_ms;
+    uint32_t              nodes;
+    uint32_t              reserved;
+    uint64_t              capacity;
+    uint64_t              names;  // device name and node names, each followed by a '\0'
+    uint64_t              times;  // Time[capacity]
+    uint64_t              values; // float[nodes][capacity], NaN in gaps
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared memory rings need lock-free 64 bit atomics");
+
+constexpr uint32_t Magic   = 0x31524753; // "SGR1"
+constexpr uint32_t Version = 1;
+
+class Writer
+{
+public:
+    // Creates the ring, replacing a leftover one with the same name. Throws std::runtime_error.
+    Writer(std::string const& name, std::vector<Device> const& devices);
+    ~Writer(); // readers see the ring closed, it is unlinked
+    Writer(Writer const&) = delete;
+    Writer& operator=(Writer const&) = delete;
+
+    std::string const&         Name() const { return m_name; }
+    std::vector<Device> const& Devices() const { return m_devices; }
+
+    // n new samples of a device: their times and the temperatures of every node, node after node (values[node * n + i])
+    void Write(size_t device, size_t n, Time const* times, float const* values);
+
+private:
+    std::string         m_name;
+    std::vector<Device> m_devices;
+    uint8_t*            m_base{nullptr};
+    size_t              m_size{0};
+};
+
+class Reader
+{
+public:
+    // Samples [begin, end) of a device, by sequence number (counts all samples the device ever wrote)
+    struct Window {
+        size_t   device;
+        uint64_t begin, end;
+
+        size_t Size() const { return static_cast<size_t>(end - begin); }
+    };
+
+    explicit Reader(std::string const& name); // throws std::runtime_error if there is no (initialized) ring
+    ~Reader();
+    Reader(Reader const&) = delete;
+    Reader& operator=(Reader const&) = delete;
+
+    std::vector<Device> const& Devices() const { return m_devices; }
+    bool                       Closed() const; // by the writer, open the ring again to follow it
+
+    Window      Last(size_t device, double seconds) const;  // newest samples, as many as the ring still has
+    Window      Since(size_t device, uint64_t begin) const; // samples from sequence begin (or the oldest kept) on
+    Span<Time>  Times(Window const& w) const;
+    Span<float> Values(Window const& w, size_t node) const;
+    bool        Valid(Window const& w) const; // check after reading, false if the writer overwrote part of it
+
+private:
+    DeviceHeader const& At(size_t device) const;
+    template <typename T>
+    Span<T> Column(Window const& w, uint64_t offset) const;
+
+    std::vector<Device> m_devices;
+    uint8_t const*      m_base{nullptr};
+    size_t              m_size{0};
+};
+} // namespace SharedRing
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <functional>
+#include <mygui/Object.hpp>
+#include <string>
+#include <vector>
+
+// Scrollable and filterable list of checkable signal names. Only the rows that fit into the widget have
+// drawables, so the cost of drawing and handling events doesn't depend on the number of signals.
+// Scroll with the mouse wheel, type while hovering over the list to filter (Esc clears the filter).
+class SignalList : public mygui::Object
+{
+public:
+    using toggle_callback_type = std::function<void(int, bool)>;  // signal index, checked
+    using info_provider_type   = std::function<std::string(int)>; // signal index -> text shown on the right of the row
+
+    SignalList(int x, int y, int w, int h);
+
+    virtual void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
+    virtual void Handle(const sf::Event& event) override;
+
+    virtual void Enabled(bool enabled) override;
+    virtual bool Enabled() const override;
+
+    sf::FloatRect GetGlobalBounds() const { return m_rect; }
+
+    void               SetSignals(std::vector<std::string> const& names);
+    void               SetAllChecked(bool checked);
+    bool               Checked(int idx) const;
+    void               Filter(std::string const& filter);
+    std::string const& Filter() const { return m_filter; }
+    void               Refresh(); // query info of visible rows again
+
+    // Actions
+    void OnToggle(const toggle_callback_type& f);
+    void InfoProvider(const info_provider_type& f);
+
+private:
+    struct Row {
+        std::string name;
+        bool        checked{true};
+    };
+
+    void ApplyFilter();
+    void Scroll(int rows);
+    void UpdateRows();
+
+    const int m_row_height{20};
+    const int m_box_size{13};
+
+    sf::FloatRect      m_rect;
+    int                m_num_visible_rows{0};
+    sf::Font           m_font;
+    sf::RectangleShape m_background;
+    sf::RectangleShape m_scrollbar;
+    sf::Text           m_filter_text;
+
+    std::vector<Row> m_rows;
+    std::vector<int> m_filtered; // indices of rows matching the filter
+    std::string      m_filter;
+    int              m_first_visible{0};
+    bool             m_mouseover{false};
+
+    // Drawables of the visible rows
+    std::vector<sf::RectangleShape> m_row_boxes;
+    std::vector<sf::RectangleShape> m_row_marks;
+    std::vector<sf::Text>           m_row_texts;
+    std::vector<sf::Text>           m_row_infos;
+    int                             m_num_drawn_rows{0};
+
+    toggle_callback_type m_onToggle{nullptr};
+    info_provider_type   m_info_provider{nullptr};
+};
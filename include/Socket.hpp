@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+// The bits of BSD sockets and Winsock that differ, for the local servers (stream server, metrics endpoint). Only
+// their sources include it, so the platform headers don't leak into the rest of the core.
+namespace Socket
+{
+#ifdef _WIN32
+using socket_t                      = SOCKET;
+using pollfd_t                      = WSAPOLLFD;
+constexpr int SendFlags             = 0;
+inline int    Poll(pollfd_t* fds, size_t n, int ms) { return WSAPoll(fds, static_cast<ULONG>(n), ms); }
+inline void   CloseSocket(socket_t s) { closesocket(s); }
+inline bool   WouldBlock() { return WSAGetLastError() == WSAEWOULDBLOCK; }
+inline void   NonBlocking(socket_t s)
+{
+    u_long on = 1;
+    ioctlsocket(s, FIONBIO, &on);
+}
+inline void Init()
+{
+    struct WinsockInit {
+        WinsockInit()
+        {
+            WSADATA data;
+            WSAStartup(MAKEWORD(2, 2), &data);
+        }
+        ~WinsockInit() { WSACleanup(); }
+    };
+    static WinsockInit winsock;
+}
+#else
+using socket_t                      = int;
+using pollfd_t                      = pollfd;
+constexpr int SendFlags             = MSG_NOSIGNAL; // a client that went away is an error, not SIGPIPE
+inline int    Poll(pollfd_t* fds, size_t n, int ms) { return poll(fds, n, ms); }
+inline void   CloseSocket(socket_t s) { close(s); }
+inline bool   WouldBlock() { return errno == EAGAIN || errno == EWOULDBLOCK; }
+inline void   NonBlocking(socket_t s) { fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK); }
+inline void   Init() {}
+#endif
+
+constexpr socket_t Invalid = static_cast<socket_t>(-1);
+
+inline sockaddr_in Loopback(uint16_t port)
+{
+    sockaddr_in addr{};
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    return addr;
+}
+
+// Non-blocking socket listening on 127.0.0.1 (local clients only), port 0 picks a free one and is set to it.
+// Throws std::runtime_error, what is the server it is for.
+inline socket_t ListenLoopback(uint16_t& port, std::string const& what)
+{
+    Init();
+    auto s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s == Invalid)
+        throw std::runtime_error(what + ": can't create socket");
+
+    int on = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<char const*>(&on), sizeof(on));
+
+    auto      addr = Loopback(port);
+    socklen_t len  = sizeof(addr);
+    if (bind(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(s, 8) != 0 ||
+        getsockname(s, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+        CloseSocket(s);
+        throw std::runtime_error(what + ": can't listen on port " + std::to_string(port));
+    }
+    NonBlocking(s);
+    port = ntohs(addr.sin_port);
+    return s;
+}
+} // namespace Socket
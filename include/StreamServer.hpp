@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Streams frames (see README for the framing) to any number of TCP clients on the loopback interface. Publish only
+// appends to the per-client queues, sending happens on the server's own thread with non-blocking sockets, so a slow
+// client can never stall ingest. Queues are bounded: when a client's queue is full its oldest unsent frame is
+// dropped, or the client is disconnected, depending on the policy.
+class StreamServer
+{
+public:
+    using Frame = std::shared_ptr<std::vector<uint8_t> const>; // shared by all clients it is queued for
+
+    enum class Overflow { DropOldest, Disconnect };
+
+    struct Settings {
+        uint16_t port{0};           // 0 - any free port
+        size_t   queue_frames{256}; // at least MinQueueFrames
+        Overflow overflow{Overflow::DropOldest};
+
+        bool operator==(Settings const& other) const { return port == other.port && queue_frames == other.queue_frames && overflow == other.overflow; }
+    };
+
+    explicit StreamServer(Settings const& settings); // throws std::runtime_error if it can't listen
+    ~StreamServer();
+    StreamServer(StreamServer const&) = delete;
+    StreamServer& operator=(StreamServer const&) = delete;
+
+    Settings const& GetSettings() const { return m_settings; }
+    uint16_t        Port() const { return m_port; } // the one listened on
+    size_t          Clients() const { return m_num_clients; }
+    uint64_t        Dropped() const { return m_dropped; } // frames dropped from full queues
+
+    void SetHello(Frame frame); // sent first to every client, queued for the connected ones too
+    void Publish(Frame frame);
+
+    // Frame of the given type with payload, as put on the wire
+    static std::vector<uint8_t> MakeFrame(uint16_t type, std::vector<uint8_t> const& payload);
+
+    static constexpr uint32_t Magic          = 0x31534753; // "SGS1"
+    static constexpr uint16_t FrameDevices   = 1;
+    static constexpr uint16_t FrameSamples   = 2;
+    static constexpr size_t   HeaderSize     = 12;
+    static constexpr size_t   MinQueueFrames = 2; // a partly sent frame and the newest one
+
+private:
+    struct Client {
+        intptr_t          socket;
+        std::deque<Frame> queue;
+        size_t            sent{0}; // bytes of the front frame already sent
+        bool              closing{false};
+    };
+
+    void Queue(Frame const& frame);
+    void Wake();
+    void Loop();
+    void Accept();
+    bool Send(Client& client); // false if the client is gone
+    void Close(Client& client);
+
+    Settings              m_settings;
+    intptr_t              m_listen{-1};
+    intptr_t              m_wake_tx{-1}, m_wake_rx{-1}; // connection to itself that wakes up the server thread
+    uint16_t              m_port{0};
+    std::mutex            m_mtx;
+    std::vector<Client>   m_clients;
+    Frame                 m_hello;
+    std::atomic<size_t>   m_num_clients{0};
+    std::atomic<uint64_t> m_dropped{0};
+    std::atomic<bool>     m_stop{false};
+    std::thread           m_thread;
+};
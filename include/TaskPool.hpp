@@ -0,0 +1,117 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Shared work-stealing thread pool for parallel work of the core (loading, conversion, export). Every worker has
+// its own deque: it pushes and pops tasks at the back, idle workers steal from the front of the others, so tasks
+// spawned by a task mostly stay on the worker (and in the cache) that spawned them.
+class TaskPool
+{
+public:
+    static TaskPool& Get(); // one worker per core
+
+    explicit TaskPool(size_t workers);
+    ~TaskPool();
+
+    size_t Workers() const { return m_workers.size(); }
+    void   Resize(size_t workers); // waits for queued tasks, 0 - one worker per core
+
+    void     Post(std::function<void()> task);
+    uint64_t ParallelNs() const { return m_parallel_ns.load(std::memory_order_relaxed); } // time spent in (outermost) task groups, from the first Run until Wait returned
+
+    template <typename F>
+    auto Submit(F&& f) -> std::future<std::invoke_result_t<F>>
+    {
+        auto task   = std::make_shared<std::packaged_task<std::invoke_result_t<F>()>>(std::forward<F>(f));
+        auto future = task->get_future();
+        Post([task] { (*task)(); });
+        return future;
+    }
+
+private:
+    struct Worker {
+        std::mutex                        mtx;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void Start(size_t workers);
+    void Stop();
+    void Loop(size_t self);
+    bool TryRun(size_t self); // self - index of the calling worker
+
+    friend class TaskGroup;
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::vector<std::thread>             m_threads;
+    std::atomic<size_t>                  m_queued{0};
+    std::atomic<size_t>                  m_next{0}; // worker that gets the next task posted from outside
+    std::atomic<uint64_t>                m_parallel_ns{0};
+    std::mutex                           m_mtx;
+    std::condition_variable              m_cv;
+    bool                                 m_stop{false};
+};
+
+// Tasks that are waited for together. Waiting runs the group's own tasks that haven't started yet and then blocks until
+// the running ones finish, so groups can be waited for from inside tasks and a waiting thread (e.g. the GUI) never
+// picks up unrelated work. After Cancel tasks that haven't started yet are skipped, running ones can check Cancelled.
+// The first exception thrown by a task is rethrown by Wait.
+class TaskGroup
+{
+public:
+    explicit TaskGroup(TaskPool& pool = TaskPool::Get()) :
+        m_pool(pool), m_state(std::make_shared<State>()) {}
+    TaskGroup(TaskGroup const&) = delete;
+    TaskGroup& operator=(TaskGroup const&) = delete;
+    ~TaskGroup();
+
+    void Run(std::function<void()> task);
+    void Wait();
+    void Cancel() { m_state->cancelled = true; }
+    bool Cancelled() const { return m_state->cancelled; }
+
+    // f(i) for i in [0, n), in chunks of grain indices
+    template <typename F>
+    void ParallelFor(size_t n, F&& f, size_t grain = 1)
+    {
+        grain = std::max<size_t>(grain, 1);
+        for (size_t begin = 0; begin < n; begin += grain) {
+            size_t end = std::min(n, begin + grain);
+            Run([&f, begin, end, this] {
+                for (size_t i = begin; i < end && !Cancelled(); ++i)
+                    f(i);
+            });
+        }
+        Wait();
+    }
+
+private:
+    // Shared with the pool tasks that run the group's tasks, they may run after the group is gone and find nothing to do
+    struct State {
+        std::mutex                                           mtx;
+        std::condition_variable                              cv;
+        std::deque<std::function<void()>>                    tasks;      // not started yet
+        size_t                                               pending{0}; // not finished yet
+        std::exception_ptr                                   error;
+        std::atomic<bool>                                    cancelled{false};
+        std::optional<std::chrono::steady_clock::time_point> parallel_since; // first Run of a group that isn't nested
+    };
+
+    static bool RunOne(State& state); // run a task of the group that hasn't started yet, false if there was none
+
+    TaskPool&              m_pool;
+    std::shared_ptr<State> m_state;
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Serializer.hpp"
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+// Receive time and firmware packet id of every stored sample of a device. Entries are delta encoded in chunks
+// that start with full values followed by zigzag varint deltas, which is about 2 bytes per entry at a steady rate.
+// Entries of missing samples are stored as runs (gaps) and rebuilt from the entries around them when read: times are
+// spread evenly between them, ids counted on. In capture files the column is written as a 'time' and a 'packet_id'
+// line, first value followed by deltas, gaps as '~<length>'. All methods are thread safe.
+class TimeColumn : public Serializer
+{
+public:
+    struct Entry {
+        uint32_t time_ms;   // host receive time since the start of the acquisition
+        uint32_t packet_id; // firmware packet id
+    };
+
+    static constexpr size_t ChunkSize = 256;
+
+    TimeColumn() = default;
+    TimeColumn(TimeColumn const& other);
+
+    virtual ser_data_t Serialize() const override;
+    virtual void       Deserialize(ser_data_t& data) override;
+
+    size_t size() const;
+    bool   empty() const { return size() == 0; }
+    void   push_back(Entry e);
+    void   append(const uint32_t* times, const uint32_t* packet_ids, size_t n);
+    void   append_gap(size_t n);                            // entries of n missing samples, stored as one run
+    size_t Read(size_t begin, size_t n, Entry* out) const; // returns number of entries copied
+    Entry  operator[](size_t idx) const;
+    Entry  back() const;
+    size_t LowerBound(uint32_t time_ms) const; // index of the first entry at or after time_ms
+    void   clear();
+    size_t ResidentBytes() const;
+
+    // Times of the stored entries in [begin, end) are replaced by time_of(index, entry), they must not decrease. Gaps
+    // stay gaps, their times follow the new ones around them.
+    void Retime(size_t begin, size_t end, std::function<uint32_t(size_t, Entry const&)> const& time_of);
+
+private:
+    struct Chunk {
+        Entry    base;
+        Entry    last;
+        uint32_t count;
+        size_t   offset; // of the deltas in m_bytes
+    };
+
+    struct Gap {
+        size_t begin; // index in the column
+        size_t length;
+        size_t stored; // stored entries before it
+    };
+
+    // Called with m_mtx held
+    void                                   Encode(Entry e);
+    void                                   Decode(size_t begin, size_t n, Entry* out) const; // stored entries, by their index among them
+    Entry                                  Stored(size_t idx) const;
+    size_t                                 ReadLocked(size_t begin, size_t n, Entry* out) const;
+    size_t                                 GapsBefore(size_t stored) const; // missing entries before stored entry stored
+    std::pair<Entry, std::optional<Entry>> Around(Gap const& gap) const;
+
+    static Entry Interpolate(Entry prev, std::optional<Entry> next, size_t k, size_t length);
+
+    mutable std::mutex   m_mtx;
+    std::vector<Chunk>   m_chunks;
+    std::vector<uint8_t> m_bytes;
+    size_t               m_stored{0};
+    std::vector<Gap>     m_gaps;
+    size_t               m_missing{0}; // entries in m_gaps
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "TimeColumn.hpp"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <vector>
+
+// Streaming k-way merge of the sample times of several sources (devices), so devices sampled at different rates
+// can be walked on one time axis. Every sample of every source is visited once, ordered by time (ties by source),
+// the time columns are read a chunk at a time. Samples are never resampled, a source without a sample at some time
+// simply has no event there.
+class Timeline
+{
+public:
+    struct Event {
+        size_t   source; // in the order of Add
+        size_t   index;  // of the sample in its source
+        uint32_t time_ms;
+    };
+
+    // size - number of samples of the source. Without receive times (time is null or shorter than size, e.g. captures
+    // made before they were recorded) sample i is placed at i * sampling_period_ms.
+    void   Add(std::shared_ptr<TimeColumn const> const& time, size_t size, uint32_t sampling_period_ms);
+    size_t Sources() const { return m_sources.size(); }
+
+    void Seek(uint32_t time_ms); // next event is the first one at or after time_ms
+    bool Next(Event& e);         // false when all sources are exhausted
+
+private:
+    struct Source {
+        std::shared_ptr<TimeColumn const> time; // null if samples have no receive times
+        size_t                            size;
+        uint32_t                          period;
+        size_t                            next{0}; // index of the next sample
+        std::vector<TimeColumn::Entry>    chunk;   // times of [chunk_begin, chunk_begin + chunk.size())
+        size_t                            chunk_begin{0};
+    };
+
+    using HeapEntry = std::pair<uint32_t, size_t>; // time of the next sample, source
+
+    uint32_t TimeAt(Source& s, size_t idx);
+    void     Push(size_t source);
+
+    std::vector<Source>                                                            m_sources;
+    std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry>> m_heap;
+};
@@ -2,6 +2,7 @@
 
 #include <memory>
 #include <mygui/Object.hpp>
+#include <optional>
 
 class Window
 {
@@ -10,12 +11,16 @@ protected:
 
     const sf::Color backgroundColor = sf::Color(235, 235, 235);
 
-    std::unique_ptr<sf::RenderWindow>    m_window;
-    std::unique_ptr<sf::Event>           m_event;
-    std::vector<std::shared_ptr<Widget>> m_widgets;
+    std::unique_ptr<sf::RenderWindow>         m_window;
+    std::unique_ptr<sf::Event>                m_event;
+    std::vector<std::shared_ptr<Widget>>      m_widgets;
+    std::vector<std::optional<sf::FloatRect>> m_hit_bounds; // per widget, std::nullopt - widget receives all events
+    Widget*                                   m_hovered{nullptr};
+    Widget*                                   m_pressed{nullptr};
 
     virtual void Events();
     virtual void Draw();
+    void         Dispatch(const sf::Event& event);
 
 public:
     Window(int w, int h, const std::string& title, sf::Uint32 style = sf::Style::Default);
@@ -23,6 +28,7 @@ public:
     void         Create(int w, int h, const std::string& title, sf::Uint32 style = sf::Style::Default);
     void         Close();
     void         Add(std::shared_ptr<Widget> const& widget);
+    void         Add(std::shared_ptr<Widget> const& widget, sf::FloatRect const& hit_bounds); // mouse events are only passed on inside hit_bounds
     void         Remove(std::shared_ptr<Widget> const& widget);
     void         Update();
     void         SetVisible(bool visible);
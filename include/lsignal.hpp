@@ -27,10 +27,15 @@ SOFTWARE.
 #ifndef LSIGNAL_H
 #define LSIGNAL_H
 
+#include <atomic>
+#include <cstddef>
 #include <functional>
 #include <list>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <tuple>
+#include <type_traits>
 #include <vector>
 
 namespace lsignal
@@ -148,6 +153,135 @@ inline slot::~slot()
     disconnect();
 }
 
+// event_queue
+
+// Emissions of queued connections waiting for the thread that owns the queue, which drains it (e.g. once per frame).
+// Events posted while draining run on the next drain.
+class event_queue
+{
+public:
+    void        post(std::function<void()>&& fn); // from any thread
+    std::size_t drain();                          // run all waiting events, returns their number
+    std::size_t pending() const;
+
+private:
+    mutable std::mutex                 _mutex;
+    std::vector<std::function<void()>> _events;
+    std::vector<std::function<void()>> _running;
+};
+
+inline void event_queue::post(std::function<void()>&& fn)
+{
+    std::lock_guard<std::mutex> locker(_mutex);
+
+    _events.push_back(std::move(fn));
+}
+
+inline std::size_t event_queue::drain()
+{
+    {
+        std::lock_guard<std::mutex> locker(_mutex);
+
+        _running.swap(_events);
+    }
+
+    for (auto& fn : _running) {
+        fn();
+    }
+
+    auto count = _running.size();
+    _running.clear();
+
+    return count;
+}
+
+inline std::size_t event_queue::pending() const
+{
+    std::lock_guard<std::mutex> locker(_mutex);
+
+    return _events.size();
+}
+
+// queued_callback
+
+// How emissions of a queued connection that wait in the queue are combined
+enum class coalesce {
+    none,   // every emission is delivered
+    latest, // only the last emission waiting is delivered
+    merge,  // emissions waiting are merged into one with the merge function of the connection
+};
+
+// Callback that posts emissions to an event queue instead of calling fn, arguments are copied. With coalescing at
+// most one event of the connection waits in the queue, so a burst of emissions causes a single call.
+template <typename... Args>
+class queued_callback
+{
+public:
+    using callback_type = std::function<void(Args...)>;
+    using args_type     = std::tuple<std::decay_t<Args>...>;
+    using merge_type    = std::function<void(args_type& pending, args_type&& next)>;
+
+    queued_callback(event_queue& queue, callback_type fn, coalesce policy = coalesce::none, merge_type merge = nullptr);
+
+    void operator()(Args... args) const;
+
+private:
+    struct state {
+        std::mutex               mutex;
+        callback_type            callback;
+        coalesce                 policy;
+        merge_type               merge;
+        std::optional<args_type> pending;
+    };
+
+    event_queue*           _queue;
+    std::shared_ptr<state> _state;
+};
+
+template <typename... Args>
+queued_callback<Args...>::queued_callback(event_queue& queue, callback_type fn, coalesce policy, merge_type merge) :
+    _queue(&queue), _state(std::make_shared<state>())
+{
+    _state->callback = std::move(fn);
+    _state->policy   = policy == coalesce::merge && !merge ? coalesce::latest : policy;
+    _state->merge    = std::move(merge);
+}
+
+template <typename... Args>
+void queued_callback<Args...>::operator()(Args... args) const
+{
+    auto st = _state;
+
+    if (st->policy == coalesce::none) {
+        _queue->post([st, values = args_type(args...)]() mutable { std::apply(st->callback, std::move(values)); });
+        return;
+    }
+
+    bool post;
+    {
+        std::lock_guard<std::mutex> locker(st->mutex);
+
+        post = !st->pending;
+        if (post || st->policy == coalesce::latest) {
+            st->pending.emplace(args...);
+        } else {
+            st->merge(*st->pending, args_type(args...));
+        }
+    }
+
+    if (post) {
+        _queue->post([st]() {
+            std::optional<args_type> values;
+            {
+                std::lock_guard<std::mutex> locker(st->mutex);
+
+                values.swap(st->pending);
+            }
+            std::apply(st->callback, std::move(*values));
+        });
+    }
+}
+
 // signal
 
 template <typename>
@@ -177,6 +311,9 @@ public:
 
     connection connect(const callback_type& fn, slot* owner = nullptr);
     connection connect(callback_type&& fn, slot* owner = nullptr);
+    // Queued connection, fn runs when queue is drained (only for signals without a result)
+    connection connect(event_queue& queue, callback_type fn, coalesce policy = coalesce::none,
+                       typename queued_callback<Args...>::merge_type merge = nullptr, slot* owner = nullptr);
 
     template <typename T, typename U>
     connection connect(T* p, const U& fn, slot* owner = nullptr);
@@ -324,6 +461,15 @@ connection signal<R(Args...)>::connect(callback_type&& fn, slot* owner)
     return create_connection(std::move(fn), owner);
 }
 
+template <typename R, typename... Args>
+connection signal<R(Args...)>::connect(event_queue& queue, callback_type fn, coalesce policy,
+                                       typename queued_callback<Args...>::merge_type merge, slot* owner)
+{
+    static_assert(std::is_void<R>::value, "Queued connections can't return results");
+
+    return create_connection(queued_callback<Args...>(queue, std::move(fn), policy, std::move(merge)), owner);
+}
+
 template <typename R, typename... Args>
 template <typename T, typename U>
 connection signal<R(Args...)>::connect(T* p, const U& fn, slot* owner)
@@ -498,6 +644,186 @@ void signal<R(Args...)>::destroy_connection(std::shared_ptr<connection_data> con
         }
     }
 }
+
+// span
+
+// Non owning view of contiguous elements, lets hot-path signals pass arrays without copying them
+template <typename T>
+class span
+{
+public:
+    using element_type = T;
+    using iterator     = T*;
+
+    span() = default;
+    span(T* data, std::size_t size);
+
+    template <typename U, typename A>
+    span(std::vector<U, A>& vec);
+    template <typename U, typename A>
+    span(const std::vector<U, A>& vec);
+
+    T*          data() const { return _data; }
+    std::size_t size() const { return _size; }
+    bool        empty() const { return _size == 0; }
+    T&          operator[](std::size_t idx) const { return _data[idx]; }
+    iterator    begin() const { return _data; }
+    iterator    end() const { return _data + _size; }
+
+private:
+    T*          _data{nullptr};
+    std::size_t _size{0};
+};
+
+template <typename T>
+span<T>::span(T* data, std::size_t size) :
+    _data(data), _size(size)
+{
+}
+
+template <typename T>
+template <typename U, typename A>
+span<T>::span(std::vector<U, A>& vec) :
+    _data(vec.data()), _size(vec.size())
+{
+}
+
+template <typename T>
+template <typename U, typename A>
+span<T>::span(const std::vector<U, A>& vec) :
+    _data(vec.data()), _size(vec.size())
+{
+}
+
+// fast_signal
+
+// Signal for hot paths. Emitting takes no lock and doesn't allocate: it walks an immutable snapshot of the
+// connected slots, published with an atomic pointer. Connecting and disconnecting copy the snapshot under a mutex
+// and publish the new one. Replaced snapshots are kept until the signal is destroyed, so an emission running on
+// another thread never walks freed memory, slots are connected rarely so they stay small.
+// Slots connected or disconnected during an emission take effect with the next one.
+
+template <typename>
+class fast_signal;
+
+template <typename... Args>
+class fast_signal<void(Args...)>
+{
+public:
+    using callback_type = std::function<void(Args...)>;
+    using id_type       = std::size_t;
+
+    fast_signal();
+    ~fast_signal();
+
+    fast_signal(const fast_signal&) = delete;
+    fast_signal& operator=(const fast_signal&) = delete;
+
+    id_type connect(callback_type fn);
+    // Queued connection, fn runs when queue is drained
+    id_type connect(event_queue& queue, callback_type fn, coalesce policy = coalesce::none,
+                    typename queued_callback<Args...>::merge_type merge = nullptr);
+    void    disconnect(id_type id);
+    void    disconnect_all();
+
+    std::size_t size() const;
+
+    void operator()(Args... args) const;
+
+private:
+    struct joint {
+        id_type       id;
+        callback_type callback;
+    };
+
+    using snapshot = std::vector<joint>;
+
+    void publish(std::unique_ptr<snapshot>&& slots); // called with _mutex held
+
+    std::atomic<const snapshot*>           _slots;
+    std::mutex                             _mutex;
+    std::vector<std::unique_ptr<snapshot>> _snapshots; // all published, the last one is current
+    id_type                                _next_id;
+};
+
+template <typename... Args>
+fast_signal<void(Args...)>::fast_signal() :
+    _slots(nullptr), _next_id(0)
+{
+    std::lock_guard<std::mutex> locker(_mutex);
+
+    publish(std::make_unique<snapshot>());
+}
+
+template <typename... Args>
+fast_signal<void(Args...)>::~fast_signal()
+{
+}
+
+template <typename... Args>
+typename fast_signal<void(Args...)>::id_type fast_signal<void(Args...)>::connect(callback_type fn)
+{
+    std::lock_guard<std::mutex> locker(_mutex);
+
+    auto slots = std::make_unique<snapshot>(*_snapshots.back());
+    auto id    = _next_id++;
+    slots->push_back({id, std::move(fn)});
+    publish(std::move(slots));
+
+    return id;
+}
+
+template <typename... Args>
+typename fast_signal<void(Args...)>::id_type fast_signal<void(Args...)>::connect(event_queue& queue, callback_type fn, coalesce policy,
+                                                                                  typename queued_callback<Args...>::merge_type merge)
+{
+    return connect(queued_callback<Args...>(queue, std::move(fn), policy, std::move(merge)));
+}
+
+template <typename... Args>
+void fast_signal<void(Args...)>::disconnect(id_type id)
+{
+    std::lock_guard<std::mutex> locker(_mutex);
+
+    auto slots = std::make_unique<snapshot>();
+    for (const auto& jnt : *_snapshots.back()) {
+        if (jnt.id != id) {
+            slots->push_back(jnt);
+        }
+    }
+    publish(std::move(slots));
+}
+
+template <typename... Args>
+void fast_signal<void(Args...)>::disconnect_all()
+{
+    std::lock_guard<std::mutex> locker(_mutex);
+
+    publish(std::make_unique<snapshot>());
+}
+
+template <typename... Args>
+std::size_t fast_signal<void(Args...)>::size() const
+{
+    return _slots.load(std::memory_order_acquire)->size();
+}
+
+template <typename... Args>
+void fast_signal<void(Args...)>::operator()(Args... args) const
+{
+    const snapshot& slots = *_slots.load(std::memory_order_acquire);
+
+    for (const auto& jnt : slots) {
+        jnt.callback(args...);
+    }
+}
+
+template <typename... Args>
+void fast_signal<void(Args...)>::publish(std::unique_ptr<snapshot>&& slots)
+{
+    _slots.store(slots.get(), std::memory_order_release);
+    _snapshots.push_back(std::move(slots));
+}
 } // namespace lsignal
 
 #endif // LSIGNAL_H
\ No newline at end of file
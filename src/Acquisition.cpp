@@ -1,10 +1,15 @@
 #include "Acquisition.hpp"
+#include "Conversion.hpp"
 #include "Helpers.hpp"
+#include "Profiler.hpp"
+#include "TaskPool.hpp"
 #include <algorithm>
 #include <ctime>
 #include <fstream>
 #include <future>
+#include <iomanip>
 #include <iostream>
+#include <limits>
 #include <map>
 #include <sstream>
 
@@ -15,15 +20,40 @@ Acquisition::~Acquisition()
 }
 
 Serializer::ser_data_t Acquisition::Serialize() const
+{
+    Serializer::ser_data_t data = SerializeHeader(GetSamplingPeriod());
+    for (auto const& dev : m_physical_devices)
+        Serializer::append(data, dev->Serialize());
+    return data;
+}
+
+Serializer::ser_data_t Acquisition::SerializeHeader(uint32_t sampling_period_ms) const
 {
     Serializer::ser_data_t data;
     auto                   dt        = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
     auto                   date_time = std::string(std::ctime(&dt));
     Serializer::append(data, date_time, "");
     Serializer::append(data, "sampling_period");
-    Serializer::append(data, m_sampling_period_ms, "ms\n");
-    for (auto const& dev : m_physical_devices)
-        Serializer::append(data, dev->Serialize());
+    Serializer::append(data, sampling_period_ms, "ms\n");
+    return data;
+}
+
+// Raw samples the devices keep before filtering, in the capture format at the hardware sampling period
+Serializer::ser_data_t Acquisition::SerializeRaw() const
+{
+    Serializer::ser_data_t data = SerializeHeader(m_sampling_period_ms);
+    for (auto const& dev : m_physical_devices) {
+        VirtualDevice raw;
+        raw.SetID(dev->GetID());
+        raw.SetName(dev->GetName());
+        raw.SetSamplingPeriod(dev->GetHardwarePeriod());
+        for (size_t i = 0; i < dev->GetNodes().size(); ++i) {
+            Node node(dev->GetNodes()[i].name());
+            node.append(dev->RawHistory(i));
+            raw.push_back(node);
+        }
+        Serializer::append(data, raw.Serialize());
+    }
     return data;
 }
 
@@ -49,6 +79,8 @@ void Acquisition::Deserialize(ser_data_t& data)
     while (std::string(data.begin(), std::find(data.begin(), data.end(), ',')) == "device") {
         m_virtual_devices.push_back(new VirtualDevice);
         m_virtual_devices.back()->Deserialize(data);
+        if (m_virtual_devices.back()->GetSamplingPeriod() == 0)
+            m_virtual_devices.back()->SetSamplingPeriod(m_sampling_period_ms);
     }
 }
 
@@ -77,19 +109,84 @@ Acquisition::AllTokens Acquisition::ParseConfigFile(const std::string& file_name
 
 void Acquisition::ConfigureFromTokens(Acquisition::AllTokens all_tokens)
 {
+    // Commands that configure a device apply to the last one
+    auto device = [this]() -> PhysicalDevice& {
+        if (m_physical_devices.empty())
+            throw std::logic_error("there is no 'device' before it");
+        return *m_physical_devices.back();
+    };
+
     std::map<std::string, std::function<void(const LineTokens&)>> commands{
+        // Before the first device it is the default of all devices, after a device only that device's
         {"sampling_period", [this](const LineTokens& args) {
-             auto prd = args.at(0);
-             if (prd.find("ms") != std::string::npos)
-                 m_sampling_period_ms = std::stoi(args.at(0));
-             else                                                     // seconds
-                 m_sampling_period_ms = std::stoi(args.at(0)) * 1000; // convert seconds to ms
+             uint32_t prd;
+             if (args.at(0).find("ms") != std::string::npos)
+                 prd = std::stoi(args.at(0));
+             else                                    // seconds
+                 prd = std::stoi(args.at(0)) * 1000; // convert seconds to ms
+             if (m_physical_devices.empty())
+                 m_sampling_period_ms = prd;
+             else
+                 m_physical_devices.back()->SetSamplingPeriod(prd);
+         }},
+        {"statistics_windows", [this](const LineTokens& args) {
+             m_statistics_windows.clear();
+             for (auto const& arg : args)
+                 m_statistics_windows.push_back({arg, NodeStatistics::ParseDuration(arg)});
+         }},
+        {"alarm", [this](const LineTokens& args) { m_alarms.AddRule(args); }},
+        {"alarm_log", [this](const LineTokens& args) { m_alarm_log_fname = args.at(0); }},
+        {"stream_server", [this](const LineTokens& args) {
+             StreamServer::Settings settings;
+             settings.port = static_cast<uint16_t>(std::stoul(args.at(0)));
+             if (args.size() > 1)
+                 settings.queue_frames = std::max<size_t>(StreamServer::MinQueueFrames, std::stoul(args[1]));
+             if (args.size() > 2 && args[2] == "disconnect")
+                 settings.overflow = StreamServer::Overflow::Disconnect;
+             else if (args.size() > 2 && args[2] != "drop_oldest")
+                 throw std::invalid_argument("Unknown stream_server overflow policy '" + args[2] + "'");
+             m_stream_settings = settings;
+         }},
+        {"metrics_port", [this](const LineTokens& args) {
+             if (!m_metrics_settings)
+                 m_metrics_settings.emplace();
+             m_metrics_settings->port = static_cast<uint16_t>(std::stoul(args.at(0)));
+         }},
+        {"metrics_file", [this](const LineTokens& args) {
+             if (!m_metrics_settings)
+                 m_metrics_settings.emplace();
+             m_metrics_settings->file = args.at(0);
+             if (args.size() > 1)
+                 m_metrics_settings->interval_ms = std::max(100u, NodeStatistics::ParseDuration(args[1]));
+         }},
+        {"shared_ring", [this](const LineTokens& args) {
+             auto name       = args.at(0)[0] == '/' ? args[0] : "/" + args[0];
+             m_ring_settings = {name, args.size() > 1 ? NodeStatistics::ParseDuration(args[1]) : 10 * 60 * 1000};
+         }},
+        {"retention_ram", [](const LineTokens& args) {
+             Retention::Get().SetBudget(Retention::ParseSize(args.at(0)));
+         }},
+        {"median", [&device](const LineTokens& args) {
+             auto settings   = device().GetFilterSettings();
+             settings.median = std::stoi(args.at(0));
+             device().SetFilter(settings);
+         }},
+        {"decimate", [&device](const LineTokens& args) {
+             auto settings       = device().GetFilterSettings();
+             settings.decimation = std::stoi(args.at(0));
+             device().SetFilter(settings);
+         }},
+        {"raw_ring", [&device](const LineTokens& args) {
+             auto settings     = device().GetFilterSettings();
+             settings.raw_ring = std::stoul(args.at(0));
+             device().SetFilter(settings);
          }},
         {"device", [this](const LineTokens& args) {m_physical_devices.push_back(new PhysicalDevice); if (args.size() > 0) m_physical_devices.back()->SetName(args.at(0)); }},
-        {"id", [this](const LineTokens& args) { m_physical_devices.back()->SetID(std::stoi(args.at(0))); }},
-        {"nodes", [this](const LineTokens& args) {
+        {"id", [&device](const LineTokens& args) { device().SetID(std::stoi(args.at(0))); }},
+        {"sample_width", [&device](const LineTokens& args) { device().SetSampleWidth(ParseSampleWidth(args.at(0))); }},
+        {"nodes", [&device](const LineTokens& args) {
             for (auto arg : args)
-                m_physical_devices.back()->push_back(Node(arg)); }},
+                device().push_back(Node(arg, device().GetSampleWidth())); }},
     };
 
     for (auto line_tokens : all_tokens) {
@@ -97,11 +194,16 @@ void Acquisition::ConfigureFromTokens(Acquisition::AllTokens all_tokens)
         std::transform(cmd.begin(), cmd.end(), cmd.begin(),
                        [](unsigned char c) { return std::tolower(c); });
         auto args = LineTokens(line_tokens.begin() + 1, line_tokens.end());
-        // Run command
-        try {
-            commands.at(cmd)(args);
-        } catch (std::out_of_range) {
+        auto it = commands.find(cmd);
+        if (it == commands.end()) {
             std::cout << "Error trying to configure device. Command '" << cmd << "' unknown!\n";
+            continue;
+        }
+        // A bad line is reported and skipped, the rest of the configuration still applies
+        try {
+            it->second(args);
+        } catch (std::exception const& e) {
+            std::cerr << "Error: config command '" << cmd << "' failed (" << e.what() << ")\n";
         }
     }
 }
@@ -113,6 +215,8 @@ void Acquisition::Save() const
         return;
     }
 
+    Profiler::ScopedTimer timer(Profiler::Stage::Save);
+
     auto get_available_filename = [](std::string base_name) -> auto
     {
         std::string suffix;
@@ -161,6 +265,16 @@ void Acquisition::Save() const
 
     // All is well :)
     std::cout << "Successfully written " << fsize << " bytes to " << fname << std::endl;
+
+    if (std::any_of(m_physical_devices.begin(), m_physical_devices.end(), [](auto const& d) { return d->GetFilterSettings().raw_ring > 0; })) {
+        auto          raw_fname = fname.substr(0, fname.size() - 4) + "_raw.txt";
+        std::ofstream raw_ofs(raw_fname, std::ofstream::out | std::ofstream::binary);
+        auto          raw       = SerializeRaw();
+        if (raw_ofs.is_open() && raw_ofs.write(raw.data(), raw.size()))
+            std::cout << "Raw samples written to " << raw_fname << std::endl;
+        else
+            std::cerr << "Error: can't write raw samples to " << raw_fname << "!\n";
+    }
 }
 
 void Acquisition::Load(std::string const& fname)
@@ -179,6 +293,11 @@ void Acquisition::Load(std::string const& fname)
 
     Deserialize(data);
 
+    for (auto& d : m_virtual_devices)
+        ProcessNewSamples(*d);
+
+    UpdateBufferGauges();
+
     std::vector<BaseDevice const*> devices(m_virtual_devices.begin(), m_virtual_devices.end());
     signal_devices_loaded(devices);
 }
@@ -191,30 +310,317 @@ void Acquisition::Clear()
         d->Clear();
     for (auto& d : m_virtual_devices)
         d->Clear();
+
+    // Times of new samples start from zero again
+    m_time_origin = std::nullopt;
+    if (m_devices_running) {
+        m_time_origin = std::chrono::steady_clock::now();
+        for (auto& d : m_physical_devices)
+            if (!Probing(d))
+                d->SetTimeOrigin(*m_time_origin);
+    }
+
+    UpdateBufferGauges();
 }
 
 void Acquisition::Reset()
 {
     std::cout << "Acquisition::Reset\n";
+    FinishReconnect(true);
     for (auto& d : m_physical_devices)
         delete d;
     for (auto& d : m_virtual_devices)
         delete d;
     m_physical_devices.clear();
     m_virtual_devices.clear();
+    m_physical_views.clear();
+    m_alarms.ClearRules();
+    m_time_origin = std::nullopt;
+
+    UpdateBufferGauges();
+}
+
+// Feed the samples added since the last call into the node statistics and (for live devices, whose first node
+// has index first_node in the alarm table) into the alarms. Values are converted the same way the chart shows them.
+// Nodes of loaded devices are processed in parallel, they don't touch the alarms.
+void Acquisition::ProcessNewSamples(BaseDevice& device, std::optional<size_t> first_node)
+{
+    auto& nodes = device.GetNodes();
+    if (first_node) {
+        m_new_raw.resize(Node::Store::BlockSize);
+        m_new_values.resize(Node::Store::BlockSize);
+        m_new_times.resize(Node::Store::BlockSize);
+        for (size_t i = 0; i < nodes.size(); ++i)
+            ProcessNode(device, nodes[i], *first_node + i, m_new_raw, m_new_values, m_new_times);
+    } else {
+        TaskGroup group;
+        group.ParallelFor(nodes.size(), [&](size_t i) {
+            std::vector<uint32_t>          raw(Node::Store::BlockSize);
+            std::vector<float>             values(Node::Store::BlockSize);
+            std::vector<TimeColumn::Entry> times(Node::Store::BlockSize);
+            ProcessNode(device, nodes[i], std::nullopt, raw, values, times);
+        });
+    }
+}
+
+// raw, values and times are scratch of BlockSize samples
+void Acquisition::ProcessNode(BaseDevice const& device, Node& node, std::optional<size_t> alarm_node, std::vector<uint32_t>& raw,
+                              std::vector<float>& values, std::vector<TimeColumn::Entry>& times)
+{
+    auto& stats = node.statistics();
+    if (!stats.Configured())
+        stats.Configure(m_statistics_windows);
+
+    for (size_t begin = stats.Position(), k; (k = node.buffer().Read(begin, raw.size(), raw.data())) > 0; begin += k) {
+        Conversion::NtcTemperature(raw.data(), values.data(), k);
+        // Samples without receive times (captures made before they were recorded) are placed at index * period
+        for (size_t j = device.GetTimeColumn().Read(begin, k, times.data()); j < k; ++j)
+            times[j] = {static_cast<uint32_t>((begin + j) * device.GetSamplingPeriod()), 0};
+        // Runs of present samples are fed one by one, gaps only advance the position
+        for (size_t j = 0; j < k;) {
+            bool   missing = raw[j] == Node::Store::Missing;
+            size_t end     = j + 1;
+            while (end < k && (raw[end] == Node::Store::Missing) == missing)
+                ++end;
+            if (missing) {
+                stats.Skip(end - j, times[end - 1].time_ms);
+                if (alarm_node)
+                    m_alarms.Gap(*alarm_node);
+            } else {
+                stats.Update(values.data() + j, times.data() + j, end - j);
+                if (alarm_node && !m_alarms.Empty())
+                    m_alarms.Evaluate(*alarm_node, values.data() + j, end - j, begin + j, m_alarm_events);
+            }
+            j = end;
+        }
+    }
+}
+
+// Server is (re)started when its settings changed, it keeps running (and its clients connected) otherwise
+void Acquisition::ApplyStreamSettings()
+{
+    if (!m_stream_settings) {
+        m_stream_server.reset();
+        return;
+    }
+    if (m_stream_server && m_stream_server->GetSettings() == *m_stream_settings)
+        return;
+
+    m_stream_server.reset();
+    try {
+        m_stream_server = std::make_unique<StreamServer>(*m_stream_settings);
+        std::cout << "Streaming samples on 127.0.0.1:" << m_stream_server->Port() << "\n";
+    } catch (std::exception const& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+    }
+}
+
+// Exporter is (re)started when its settings changed, so scrapers aren't interrupted by a reconnect
+void Acquisition::ApplyMetricsSettings()
+{
+    if (!m_metrics_settings) {
+        m_metrics_exporter.reset();
+        return;
+    }
+    if (m_metrics_exporter && m_metrics_exporter->GetSettings() == *m_metrics_settings)
+        return;
+
+    m_metrics_exporter.reset();
+    try {
+        m_metrics_exporter = std::make_unique<MetricsExporter>(*m_metrics_settings);
+        if (m_metrics_settings->port)
+            std::cout << "Serving metrics on http://127.0.0.1:" << m_metrics_exporter->Port() << "/metrics\n";
+        if (!m_metrics_settings->file.empty())
+            std::cout << "Writing metrics to " << m_metrics_settings->file << " every " << m_metrics_settings->interval_ms << "ms\n";
+    } catch (std::exception const& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+    }
+}
+
+// Ring is (re)created when its name, history length or the devices changed, readers keep it mapped otherwise
+void Acquisition::ApplySharedRing()
+{
+    if (!m_ring_settings) {
+        m_shared_ring.reset();
+        return;
+    }
+
+    std::vector<SharedRing::Device> devices;
+    for (auto const* dev : m_physical_devices) {
+        uint32_t period = std::max(1u, dev->GetSamplingPeriod());
+        devices.push_back({dev->GetID(), period, dev->GetName(), {}, std::max<size_t>(1, m_ring_settings->second / period)});
+        for (auto const& n : dev->GetNodes())
+            devices.back().nodes.push_back(n.name());
+    }
+    if (m_shared_ring && m_shared_ring->Name() == m_ring_settings->first && m_shared_ring->Devices() == devices)
+        return;
+
+    m_shared_ring.reset();
+    try {
+        m_shared_ring = std::make_unique<SharedRing::Writer>(m_ring_settings->first, devices);
+        std::cout << "Publishing samples to shared memory " << m_ring_settings->first << "\n";
+    } catch (std::exception const& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+    }
+}
+
+// Devices frame, the first one every stream client gets: device count, then per device id, sampling period, name and
+// node names. Strings are a 16 bit length followed by the characters. Samples stored so far aren't published.
+void Acquisition::PublishDevices()
+{
+    m_published.clear();
+    for (auto const& dev : m_physical_devices)
+        m_published.push_back(dev->GetNodes().empty() ? 0 : dev->GetNodes()[0].buffer().size());
+
+    ApplySharedRing();
+    if (!m_stream_server)
+        return;
+
+    std::vector<uint8_t> payload;
+    auto                 put = [&](auto val) { payload.insert(payload.end(), reinterpret_cast<uint8_t const*>(&val), reinterpret_cast<uint8_t const*>(&val) + sizeof(val)); };
+    auto                 put_string = [&](std::string const& str) {
+        put(static_cast<uint16_t>(str.size()));
+        payload.insert(payload.end(), str.begin(), str.end());
+    };
+
+    put(static_cast<uint32_t>(m_physical_devices.size()));
+    for (auto const& dev : m_physical_devices) {
+        put(static_cast<int32_t>(dev->GetID()));
+        put(static_cast<uint32_t>(dev->GetSamplingPeriod()));
+        put_string(dev->GetName());
+        put(static_cast<uint16_t>(dev->GetNodes().size()));
+        for (auto const& n : dev->GetNodes())
+            put_string(n.name());
+    }
+    m_stream_server->SetHello(std::make_shared<std::vector<uint8_t> const>(StreamServer::MakeFrame(StreamServer::FrameDevices, payload)));
+}
+
+// Samples a device stored since they were last published, read and converted once for the stream clients and the
+// shared ring. The samples frame has the device id, index of the first sample, sample count n and node count, then
+// receive time and packet id of the n samples and n temperatures of every node (NaN for gaps). Nothing is read while
+// there is no stream client and no shared ring.
+void Acquisition::PublishNewSamples(size_t device)
+{
+    if (device >= m_published.size())
+        return;
+
+    auto const& dev    = *m_physical_devices[device];
+    auto const& nodes  = dev.GetNodes();
+    size_t      size   = nodes.empty() ? 0 : nodes[0].buffer().size();
+    auto&       first  = m_published[device];
+    bool        stream = m_stream_server && m_stream_server->Clients() > 0;
+    if (first > size)
+        first = 0; // cleared meanwhile
+    if ((!stream && !m_shared_ring) || first == size) {
+        first = size;
+        return;
+    }
+
+    size_t n = size - first;
+    m_publish_entries.assign(n, TimeColumn::Entry{0, 0});
+    dev.GetTimeColumn().Read(first, n, m_publish_entries.data());
+    m_publish_raw.resize(n);
+    m_publish_values.resize(n * nodes.size());
+    for (size_t k = 0; k < nodes.size(); ++k) {
+        auto values = m_publish_values.data() + k * n;
+        nodes[k].buffer().Read(first, n, m_publish_raw.data());
+        Conversion::NtcTemperature(m_publish_raw.data(), values, n);
+        for (size_t i = 0; i < n; ++i)
+            if (m_publish_raw[i] == Node::Store::Missing)
+                values[i] = std::numeric_limits<float>::quiet_NaN();
+    }
+
+    if (stream) {
+        std::vector<uint8_t> payload;
+        payload.reserve(16 + n * sizeof(TimeColumn::Entry) + m_publish_values.size() * sizeof(float));
+        auto put = [&](auto val) { payload.insert(payload.end(), reinterpret_cast<uint8_t const*>(&val), reinterpret_cast<uint8_t const*>(&val) + sizeof(val)); };
+        put(static_cast<int32_t>(dev.GetID()));
+        put(static_cast<uint32_t>(first));
+        put(static_cast<uint32_t>(n));
+        put(static_cast<uint16_t>(nodes.size()));
+        put(uint16_t{0}); // reserved
+        for (auto const& t : m_publish_entries) {
+            put(t.time_ms);
+            put(t.packet_id);
+        }
+        for (auto v : m_publish_values)
+            put(v);
+        m_stream_server->Publish(std::make_shared<std::vector<uint8_t> const>(StreamServer::MakeFrame(StreamServer::FrameSamples, payload)));
+    }
+
+    if (m_shared_ring) {
+        m_publish_times.resize(n);
+        for (size_t i = 0; i < n; ++i)
+            m_publish_times[i] = {m_publish_entries[i].time_ms, m_publish_entries[i].packet_id};
+        m_shared_ring->Write(device, n, m_publish_times.data(), m_publish_values.data());
+    }
+    first = size;
+}
+
+void Acquisition::ReportAlarms()
+{
+    if (m_alarm_events.empty())
+        return;
+
+    if (!m_alarm_log.is_open()) {
+        m_alarm_log.open(m_alarm_log_fname, std::ofstream::out | std::ofstream::app);
+        if (!m_alarm_log.is_open())
+            std::cerr << "Error: can't open alarm log " << m_alarm_log_fname << "!\n";
+    }
+
+    auto dt = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    for (auto const& alarm : m_alarm_events) {
+        std::cout << "ALARM " << alarm.ToString() << "\n";
+        if (m_alarm_log.is_open())
+            m_alarm_log << std::put_time(std::localtime(&dt), "%Y-%m-%d %H:%M:%S") << " " << alarm.ToString() << "\n";
+        signal_alarm(alarm);
+    }
+    m_alarm_log.flush();
+    m_alarm_events.clear();
+}
+
+// Resident bytes include chart data, spilled samples are not counted
+void Acquisition::UpdateBufferGauges() const
+{
+    auto const& retention = Retention::Get();
+    Profiler::Get().Set(Profiler::Gauge::BufferBytes, retention.ResidentBytes());
+    Profiler::Get().Set(Profiler::Gauge::BufferBudgetBytes, retention.Budget());
+    Profiler::Get().Set(Profiler::Gauge::SpilledBytes, retention.SpilledBytes());
 }
 
 void Acquisition::ReadData()
 {
     if (m_devices_connected) {
+        WatchHotplug();
+        FinishReconnect(false);
+        auto connected = std::count_if(m_physical_devices.begin(), m_physical_devices.end(), [this](PhysicalDevice const* dev) { return !Probing(dev) && dev->IsConnected(); });
+        Profiler::Get().Set(Profiler::Gauge::ConnectedDevices, connected);
+
         if (m_devices_running) {
-            int cnt = 0;
-            for (auto& dev : m_physical_devices)
-                cnt += dev->ReadData();
+
+            // A device that fails is dropped (keeping its samples), the others keep streaming
+            int    cnt        = 0;
+            size_t first_node = 0;
+            for (size_t d = 0; d < m_physical_devices.size(); ++d) {
+                auto& dev = m_physical_devices[d];
+                try {
+                    if (int n = Probing(dev) ? 0 : dev->ReadData(); n > 0) {
+                        ProcessNewSamples(*dev, first_node);
+                        PublishNewSamples(d);
+                        cnt += n;
+                    }
+                } catch (std::exception const& e) {
+                    std::cerr << "Error: device ID:" << dev->GetID() << " failed (" << e.what() << "), reconnect to retry it\n";
+                    dev->Drop();
+                    Profiler::Get().Add(Profiler::Counter::DeviceFailures);
+                }
+                first_node += dev->GetNodes().size();
+            }
+            ReportAlarms();
 
             if (cnt > 0) {
-                std::vector<BaseDevice const*> devices(m_physical_devices.begin(), m_physical_devices.end());
-                signal_new_data(devices);
+                UpdateBufferGauges();
+                signal_new_data(m_physical_views);
             }
         }
     }
@@ -238,8 +644,16 @@ void Acquisition::StartDevices()
     if (m_devices_running)
         return;
 
-    for (auto& dev : m_physical_devices)
+    // Origin is kept across stop / start, so the receive times show the pause
+    if (!m_time_origin)
+        m_time_origin = std::chrono::steady_clock::now();
+
+    for (auto& dev : m_physical_devices) {
+        if (Probing(dev) || !dev->IsConnected())
+            continue;
+        dev->SetTimeOrigin(*m_time_origin);
         dev->Start();
+    }
 
     std::cout << "Started data acquisition\n\n";
     m_devices_running = true;
@@ -254,7 +668,8 @@ void Acquisition::StopDevices()
         return;
 
     for (auto& dev : m_physical_devices)
-        dev->Stop();
+        if (!Probing(dev) && dev->IsConnected())
+            dev->Stop();
 
     std::cout << "Stopped data acquisition\n\n";
     m_devices_running = false;
@@ -281,41 +696,263 @@ void Acquisition::ConnectToDevices()
 
         // Initial parameters from file init
         auto tokens = ParseConfigFile("config.txt");
+        m_stream_settings.reset();
+        m_ring_settings.reset();
+        m_metrics_settings.reset();
         ConfigureFromTokens(tokens);
+        ApplyDeviceDefaults(m_physical_devices);
+        CompileAlarms();
+        ApplyStreamSettings();
+        ApplyMetricsSettings();
 
-        // Connect to configured devices
-        bool connected = true;
+        // Connect to configured devices, the ones that can't be found can be retried with Reconnect
+        size_t connected = 0;
         for (auto& dev : m_physical_devices) {
-            if (dev->TryConnect())
-                dev->SetSamplingPeriod(m_sampling_period_ms);
-            else
-                connected = false;
+            if (dev->TryConnect()) {
+                dev->SendSamplingPeriod();
+                connected++;
+            }
         }
 
-        if (!connected)
-            throw std::runtime_error("Can't connect to all devices!");
+        if (connected == 0)
+            throw std::runtime_error("Can't connect to any device!");
 
-        std::cout << "Connected to all devices\n\n";
-        m_devices_connected = connected;
+        if (connected < m_physical_devices.size())
+            std::cout << "Connected to " << connected << " of " << m_physical_devices.size() << " devices, reconnect to retry the others\n\n";
+        else
+            std::cout << "Connected to all devices\n\n";
+        m_devices_connected = true;
         StopDevices();
-        std::vector<BaseDevice const*> devices(m_physical_devices.begin(), m_physical_devices.end());
-        signal_devices_loaded(devices);
+        m_physical_views.assign(m_physical_devices.begin(), m_physical_devices.end());
+        PublishDevices();
+        signal_devices_loaded(m_physical_views);
+    }
+}
+
+// Reconcile the live devices with config.txt. Devices whose configuration didn't change keep their connection and
+// samples, the ones that failed are probed again, changed and new devices replace the old ones and devices that
+// were removed are disconnected. Probing runs on its own thread, so the healthy devices keep streaming meanwhile.
+void Acquisition::Reconnect()
+{
+    if (!m_devices_connected) {
+        std::cout << "Not connected, nothing to reconnect\n";
+        return;
+    }
+    if (m_probe.valid()) {
+        std::cout << "Reconnect already in progress\n";
+        return;
+    }
+
+    std::cout << "Reconnecting changed and failed devices...\n";
+
+    // If the configuration can't be applied the live devices and the settings are kept as they are
+    auto live    = std::move(m_physical_devices);
+    auto alarms  = m_alarms;
+    auto stream  = m_stream_settings;
+    auto ring    = m_ring_settings;
+    auto metrics = m_metrics_settings;
+    auto period  = m_sampling_period_ms;
+    auto windows = m_statistics_windows;
+    auto log     = m_alarm_log_fname;
+    auto budget  = Retention::Get().Budget();
+    m_physical_devices.clear();
+    try {
+        m_alarms.ClearRules();
+        m_stream_settings.reset();
+        m_ring_settings.reset();
+        m_metrics_settings.reset();
+        ConfigureFromTokens(ParseConfigFile("config.txt"));
+    } catch (std::exception const& e) {
+        std::cerr << "Error: can't reconfigure (" << e.what() << "), devices are kept as they are\n";
+        for (auto* dev : m_physical_devices)
+            delete dev;
+        m_physical_devices   = std::move(live);
+        m_alarms             = std::move(alarms);
+        m_stream_settings    = stream;
+        m_ring_settings      = ring;
+        m_metrics_settings   = metrics;
+        m_sampling_period_ms = period;
+        m_statistics_windows = std::move(windows);
+        m_alarm_log_fname    = log;
+        Retention::Get().SetBudget(budget);
+        return;
+    }
+    auto wanted = std::move(m_physical_devices);
+    m_physical_devices.clear();
+    ApplyDeviceDefaults(wanted);
+
+    for (auto* dev : wanted) {
+        auto it = std::find_if(live.begin(), live.end(), [&](PhysicalDevice* d) { return d->GetID() == dev->GetID(); });
+        if (it != live.end() && (*it)->SameConfig(*dev)) {
+            delete dev;
+            dev = *it;
+            live.erase(it);
+            if (!dev->IsConnected())
+                m_probing.push_back(dev);
+        } else {
+            if (it != live.end())
+                std::cout << "Device ID:" << dev->GetID() << " changed, its samples are dropped\n";
+            m_probing.push_back(dev);
+        }
+        m_physical_devices.push_back(dev);
+    }
+
+    // Removed and changed devices release their ports before the new ones are probed
+    for (auto* dev : live) {
+        try {
+            dev->Disconnect();
+        } catch (std::exception const&) {
+            dev->Drop();
+        }
+        delete dev;
     }
+
+    CompileAlarms();
+    ApplyStreamSettings();
+    ApplyMetricsSettings();
+    m_physical_views.assign(m_physical_devices.begin(), m_physical_devices.end());
+    PublishDevices();
+    signal_devices_loaded(m_physical_views);
+
+    if (m_probing.empty())
+        std::cout << "All devices are connected\n\n";
+    else
+        Probe();
+}
+
+void Acquisition::Probe()
+{
+    // Serial I/O blocks, so probing gets its own thread instead of occupying a worker of the compute pool. A device
+    // that fails is dropped (port closed), so it is reported as not reconnected, the others are still probed.
+    m_probe = std::async(std::launch::async, [devices = m_probing] {
+        for (auto* dev : devices) {
+            try {
+                if (dev->TryConnect())
+                    dev->SendSamplingPeriod();
+            } catch (std::exception const& e) {
+                std::cerr << "Error: probing device ID:" << dev->GetID() << " failed (" << e.what() << ")\n";
+                dev->Drop();
+            }
+        }
+    });
+}
+
+// A removed port drops the device connected to it right away, instead of waiting for its reads to fail. Ports that
+// appear are probed for the dropped devices (by ID, whatever name the port gets) once udev had time to set them up.
+void Acquisition::WatchHotplug()
+{
+    using namespace std::chrono_literals;
+
+    for (auto const& e : m_hotplug.Poll()) {
+        if (e.added) {
+            m_reattach_at = std::chrono::steady_clock::now() + 1s;
+            continue;
+        }
+        for (auto* dev : m_physical_devices) {
+            if (!Probing(dev) && dev->IsConnected() && dev->GetPort() == e.port) {
+                std::cout << "Device ID:" << dev->GetID() << " unplugged from " << e.port << "\n";
+                dev->Drop();
+            }
+        }
+    }
+
+    if (!m_reattach_at || std::chrono::steady_clock::now() < *m_reattach_at || m_probe.valid())
+        return;
+    m_reattach_at.reset();
+
+    for (auto* dev : m_physical_devices)
+        if (!dev->IsConnected())
+            m_probing.push_back(dev);
+    if (!m_probing.empty()) {
+        std::cout << "Reattaching dropped devices...\n";
+        Probe();
+    }
+}
+
+// Devices probed by Reconnect join the acquisition once probing is done, wait - block until it is
+void Acquisition::FinishReconnect(bool wait)
+{
+    using namespace std::chrono_literals;
+
+    if (!m_probe.valid() || (!wait && m_probe.wait_for(0s) != std::future_status::ready))
+        return;
+
+    try {
+        m_probe.get();
+    } catch (std::exception const& e) {
+        std::cerr << "Error while reconnecting: " << e.what() << "\n";
+    }
+
+    auto probing = std::move(m_probing);
+    m_probing.clear();
+    for (auto* dev : probing) {
+        if (!dev->IsConnected()) {
+            std::cout << "Could not reconnect device ID:" << dev->GetID() << "\n";
+            continue;
+        }
+        std::cout << "Reconnected device ID:" << dev->GetID() << "\n";
+        if (m_devices_running) {
+            try {
+                dev->SetTimeOrigin(*m_time_origin);
+                dev->Start();
+            } catch (std::exception const& e) {
+                std::cerr << "Error: can't start device ID:" << dev->GetID() << " (" << e.what() << ")\n";
+                dev->Drop();
+            }
+        }
+    }
+}
+
+bool Acquisition::Probing(PhysicalDevice const* dev) const
+{
+    return std::find(m_probing.begin(), m_probing.end(), dev) != m_probing.end();
+}
+
+// Devices without a sampling period of their own get the default one
+void Acquisition::ApplyDeviceDefaults(std::vector<PhysicalDevice*> const& devices) const
+{
+    for (auto* dev : devices)
+        if (dev->GetHardwarePeriod() == 0)
+            dev->SetSamplingPeriod(m_sampling_period_ms);
+}
+
+// Every device is stored at its own rate, so rates of change are per node
+void Acquisition::CompileAlarms()
+{
+    std::vector<std::string> node_names;
+    std::vector<uint32_t>    node_periods;
+    for (auto const& dev : m_physical_devices) {
+        for (auto const& n : dev->GetNodes()) {
+            node_names.push_back(n.name());
+            node_periods.push_back(dev->GetSamplingPeriod());
+        }
+    }
+    m_alarms.Compile(node_names, node_periods);
 }
 
 void Acquisition::DisconnectFromDevices()
 {
     if (m_devices_connected) {
+        FinishReconnect(true);
         StopDevices();
         // Do not clear m_physical_devices, just manually disconnect. This allows saving data after disconnecting.
         for (auto& dev : m_physical_devices)
             dev->Disconnect();
         m_devices_connected = false;
+        Profiler::Get().Set(Profiler::Gauge::ConnectedDevices, 0);
         std::cout << "Disconnected from all devices\n\n";
     }
 }
 
+// Shortest period of the stored samples of all devices, the default period if there are no devices
 uint32_t Acquisition::GetSamplingPeriod() const
 {
-    return m_sampling_period_ms;
+    uint32_t period = 0;
+    auto     update = [&](BaseDevice const* dev) {
+        if (dev->GetSamplingPeriod() > 0)
+            period = period == 0 ? dev->GetSamplingPeriod() : std::min(period, dev->GetSamplingPeriod());
+    };
+    std::for_each(m_physical_devices.begin(), m_physical_devices.end(), update);
+    std::for_each(m_virtual_devices.begin(), m_virtual_devices.end(), update);
+    return period > 0 ? period : m_sampling_period_ms;
 }
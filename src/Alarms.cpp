@@ -0,0 +1,145 @@
+#include "Alarms.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+std::string Alarm::ToString() const
+{
+    std::stringstream ss;
+    ss << node << " " << AlarmEngine::Name(kind) << " alarm " << (raised ? "raised" : "cleared") << ": " << value
+       << (kind == Kind::Rate ? " /s" : "") << " (limit " << limit << ", sample " << sample_index << ")";
+    return ss.str();
+}
+
+const char* AlarmEngine::Name(Alarm::Kind kind)
+{
+    switch (kind) {
+    case Alarm::Kind::High:
+        return "high";
+    case Alarm::Kind::Low:
+        return "low";
+    case Alarm::Kind::Rate:
+        return "rate";
+    default:
+        return "unknown";
+    }
+}
+
+void AlarmEngine::AddRule(std::vector<std::string> const& args)
+{
+    if (args.size() < 3)
+        throw std::invalid_argument("Alarm needs a node, kind and limit");
+
+    Rule rule;
+    rule.pattern = args[0];
+    if (args[1] == "high")
+        rule.kind = Alarm::Kind::High;
+    else if (args[1] == "low")
+        rule.kind = Alarm::Kind::Low;
+    else if (args[1] == "rate")
+        rule.kind = Alarm::Kind::Rate;
+    else
+        throw std::invalid_argument("Unknown alarm kind: " + args[1]);
+    rule.limit      = std::stof(args[2]);
+    rule.hysteresis = args.size() > 3 ? std::stof(args[3]) : 0.f;
+    if (rule.hysteresis < 0)
+        throw std::invalid_argument("Negative alarm hysteresis: " + args[3]);
+
+    m_rules.push_back(rule);
+}
+
+void AlarmEngine::ClearRules()
+{
+    m_rules.clear();
+    m_table.clear();
+    m_node_begin.clear();
+    m_node_names.clear();
+}
+
+void AlarmEngine::Compile(std::vector<std::string> const& node_names, std::vector<uint32_t> const& sampling_periods_ms)
+{
+    auto matches = [](std::string const& pattern, std::string const& name) {
+        if (!pattern.empty() && pattern.back() == '*')
+            return name.compare(0, pattern.size() - 1, pattern, 0, pattern.size() - 1) == 0;
+        return pattern == name;
+    };
+
+    m_node_names = node_names;
+    m_table.clear();
+    m_node_begin.assign(1, 0);
+    for (auto const& name : node_names) {
+        for (auto const& r : m_rules) {
+            if (!matches(r.pattern, name))
+                continue;
+
+            Entry e;
+            e.kind   = r.kind;
+            e.limit  = r.limit;
+            e.rate   = r.kind == Alarm::Kind::Rate;
+            e.active = false;
+            if (r.kind == Alarm::Kind::Low) {
+                e.sign  = -1.f;
+                e.set   = -r.limit;
+                e.clear = -(r.limit + r.hysteresis);
+            } else {
+                e.sign  = 1.f;
+                e.set   = r.limit;
+                e.clear = r.limit - r.hysteresis;
+            }
+            m_table.push_back(e);
+        }
+        m_node_begin.push_back(m_table.size());
+    }
+
+    for (auto const& r : m_rules)
+        if (std::none_of(node_names.begin(), node_names.end(), [&](auto const& name) { return matches(r.pattern, name); }))
+            std::cout << "Alarm for '" << r.pattern << "' doesn't match any node!\n";
+
+    m_prev.assign(node_names.size(), std::numeric_limits<float>::quiet_NaN());
+    m_samples_per_s.assign(node_names.size(), 1.f);
+    for (size_t i = 0; i < node_names.size() && i < sampling_periods_ms.size(); ++i)
+        if (sampling_periods_ms[i] > 0)
+            m_samples_per_s[i] = 1000.f / sampling_periods_ms[i];
+}
+
+void AlarmEngine::Gap(size_t node)
+{
+    if (node < m_prev.size())
+        m_prev[node] = std::numeric_limits<float>::quiet_NaN();
+}
+
+void AlarmEngine::Evaluate(size_t node, const float* values, size_t n, uint64_t first, std::vector<Alarm>& events)
+{
+    if (node + 1 >= m_node_begin.size() || n == 0)
+        return;
+
+    auto begin = m_node_begin[node];
+    auto end   = m_node_begin[node + 1];
+
+    // Rates are only needed if the node has a rate rule, the first sample ever has none
+    if (std::any_of(m_table.begin() + begin, m_table.begin() + end, [](Entry const& e) { return e.rate; })) {
+        m_rate.resize(n);
+        float prev = std::isnan(m_prev[node]) ? values[0] : m_prev[node];
+        for (size_t i = 0; i < n; ++i) {
+            m_rate[i] = std::fabs(values[i] - prev) * m_samples_per_s[node];
+            prev      = values[i];
+        }
+    }
+    m_prev[node] = values[n - 1];
+
+    for (auto idx = begin; idx < end; ++idx) {
+        auto&        e     = m_table[idx];
+        const float* input = e.rate ? m_rate.data() : values;
+        for (size_t i = 0; i < n; ++i) {
+            float s      = e.sign * input[i];
+            bool  active = (s > e.set) | (e.active & (s >= e.clear));
+            if (active != e.active) {
+                e.active = active;
+                events.push_back({m_node_names[node], e.kind, active, input[i], e.limit, first + i});
+            }
+        }
+    }
+}
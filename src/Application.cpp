@@ -1,4 +1,5 @@
 #include "Application.hpp"
+#include "Profiler.hpp"
 #include <mygui/ResourceManager.hpp>
 
 using namespace std::chrono_literals;
@@ -7,7 +8,9 @@ void Application::MainLoop()
 {
     while (m_mainWindow->IsOpen()) {
         m_acquisition->ReadData();
+        m_gui_events.drain();
         m_mainWindow->Update();
+        Profiler::Get().Tick();
         // 60 FPS is enough
         std::this_thread::sleep_for(15ms);
     }
@@ -46,10 +49,17 @@ Application::Application()
         m_mainWindow->Chart()->SetAxisX(0);
     });
 
-    m_acquisition->signal_new_data.connect([this](std::vector<BaseDevice const*> const& devices) {
-        m_mainWindow->Chart()->Update(devices);
+    m_mainWindow->signal_reconnect_requested.connect([this] {
+        m_acquisition->Reconnect();
     });
 
+    // Chart is updated once per frame no matter how many reads brought new data, and only on the GUI thread
+    m_acquisition->signal_new_data.connect(
+        m_gui_events, [this](lsignal::span<BaseDevice const* const>) {
+            m_mainWindow->Chart()->Update();
+        },
+        lsignal::coalesce::latest);
+
     m_acquisition->signal_devices_loaded.connect([this](std::vector<BaseDevice const*> const& devices) {
         m_mainWindow->Chart()->SetSamplingPeriod(m_acquisition->GetSamplingPeriod());
         m_mainWindow->Chart()->LoadDevices(devices);
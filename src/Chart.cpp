@@ -1,4 +1,7 @@
 #include "Chart.hpp"
+#include "Conversion.hpp"
+#include "TaskPool.hpp"
+#include <algorithm>
 #include <iomanip>
 #include <mygui/ResourceManager.hpp>
 #include <sstream>
@@ -37,6 +40,22 @@ Chart::Chart(int x, int y, int w, int h, int num_of_points, float max_val) :
     m_y_axis.setString("Temperature / *C");
     m_y_axis.setPosition(sf::Vector2f(x + m_margin / 4.f, y + h / 2.f + m_y_axis.getLocalBounds().width / 2.f));
 
+    m_profiler_text.setFont(m_font);
+    m_profiler_text.setFillColor(sf::Color::Black);
+    m_profiler_text.setCharacterSize(14);
+    m_profiler_text.setPosition(m_chart_rect.left + 10.f, m_chart_rect.top + 10.f);
+    m_profiler_background.setFillColor(sf::Color(255, 255, 255, 220));
+    m_profiler_background.setOutlineColor(sf::Color::Black);
+    m_profiler_background.setOutlineThickness(1.f);
+    m_profiler_background.setPosition(m_chart_rect.left + 5.f, m_chart_rect.top + 5.f);
+
+    m_statistics_text.setFont(m_font);
+    m_statistics_text.setFillColor(sf::Color::Black);
+    m_statistics_text.setCharacterSize(12);
+    m_statistics_background.setFillColor(sf::Color(255, 255, 255, 220));
+    m_statistics_background.setOutlineColor(sf::Color::Black);
+    m_statistics_background.setOutlineThickness(1.f);
+
     CreateGrid(11, 9);
 }
 
@@ -55,6 +74,14 @@ void Chart::draw(sf::RenderTarget& target, sf::RenderStates states) const
     for (int i = 0; i < m_chart_signals.size(); ++i) {
         target.draw(*m_chart_signals[i]);
     }
+    if (m_show_profiler) {
+        target.draw(m_profiler_background);
+        target.draw(m_profiler_text);
+    }
+    if (m_show_statistics) {
+        target.draw(m_statistics_background);
+        target.draw(m_statistics_text);
+    }
 }
 
 void Chart::Handle(const sf::Event& event)
@@ -62,16 +89,6 @@ void Chart::Handle(const sf::Event& event)
     if (!Enabled())
         return;
 
-    auto change_draw_index = [this](int ci) {
-        if (m_chart_signals.size() <= 0)
-            return;
-
-        for (auto& ch : m_chart_signals)
-            ch->ChangeDrawIndex(ci);
-
-        SetAxisX(m_chart_signals.front()->GetDrawIndex());
-    };
-
     //  && m_chart_region.getGlobalBounds().contains(sf::Vector2f(event.mouseButton.x, event.mouseButton.y))
     if (event.type == sf::Event::MouseWheelScrolled && m_mouseover) {
         // Currently not implemented
@@ -87,6 +104,10 @@ void Chart::Handle(const sf::Event& event)
 
         //    CreateAxisMarkers();
         //}
+    } else if (event.type == sf::Event::KeyReleased && event.key.code == sf::Keyboard::F3) {
+        ToggleProfilerOverlay();
+    } else if (event.type == sf::Event::KeyReleased && event.key.code == sf::Keyboard::F4) {
+        ToggleStatisticsOverlay();
     } else if (event.type == sf::Event::KeyReleased && m_mouseover) {
         if (m_onKeyPress)
             m_onKeyPress(event);
@@ -96,12 +117,12 @@ void Chart::Handle(const sf::Event& event)
     } else if (event.type == sf::Event::MouseButtonReleased && event.mouseButton.button == sf::Mouse::Left) {
         m_holding_left_mouse_button = false;
         if (m_mouseover)
-            change_draw_index(m_mouse_drag_start_pos_x - event.mouseButton.x);
+            Scroll(m_mouse_drag_start_pos_x - event.mouseButton.x);
     } else if (event.type == sf::Event::MouseMoved) {
         if (m_chart_region.getGlobalBounds().contains(sf::Vector2f(event.mouseMove.x, event.mouseMove.y))) {
             m_mouseover = true;
             if (m_holding_left_mouse_button) {
-                change_draw_index(m_mouse_drag_start_pos_x - event.mouseMove.x);
+                Scroll(m_mouse_drag_start_pos_x - event.mouseMove.x);
 
                 m_mouse_drag_start_pos_x = event.mouseMove.x;
             }
@@ -112,6 +133,24 @@ void Chart::Handle(const sf::Event& event)
     }
 }
 
+// Dragging moves the view, dragging it to the newest samples makes it follow them again
+void Chart::Scroll(int pixels)
+{
+    if (m_chart_signals.size() <= 0)
+        return;
+
+    uint32_t last = 0;
+    for (auto& ch : m_chart_signals)
+        last = std::max(last, ch->LastTime());
+
+    const float window = m_chart_rect.width * MsPerPixel();
+    float       start  = std::clamp(m_start_ms + pixels * MsPerPixel(), 0.f, std::max(0.f, last - window));
+    m_start_ms         = static_cast<uint32_t>(start);
+    m_follow           = start + window >= last;
+
+    UpdateView();
+}
+
 void Chart::Enabled(bool enabled)
 {
     m_enabled = enabled;
@@ -126,32 +165,6 @@ bool Chart::Enabled() const
 }
 
 // Convert data from raw ADC voltage to NTC temperature
-void Chart::ConvertData(std::vector<float>& data)
-{
-    // Calculate degrees from raw data
-    // NTC equation
-    const float vcc   = 3.0;
-    const float r1    = 5600.f;
-    const float beta  = 4920.f; // datasheet
-    const float rntc0 = 33000.f;
-    const float t0    = 298.15; // 25 *C
-    const float rinf  = rntc0 * std::exp(-beta / t0);
-    for (auto& y : data) {
-        //auto vntc = vcc * y / 4096.f;
-        // Vntc = Vcc * Rntc / (R1 + Rntc);
-        // Vntc * R1 + Vntc * Rntc = Vcc * Rntc
-        // Rntc * (Vcc - Vntc) = Vntc * R1
-        // Rntc = Vntc / (Vcc - Vntc) * R1;
-        //float rntc = vntc / (vcc - vntc) * r1;
-
-        // Temperature: Tntc = beta / (ln(Rntc/Rinf))
-        //y = beta / std::log(rntc / rinf) - 273.15;
-
-        // Using Wolfram alpha I simplified the equation. Notice Vcc is not used, since to calculate rntc we only need the adc ratio value, no the absolute.
-        y = beta / (std::log(-y / (y - 4096.f)) + 14.728) - 273.15;
-    }
-}
-
 void Chart::LoadDevices(std::vector<BaseDevice const*> const& devices)
 {
     m_chart_signals.clear();
@@ -161,33 +174,49 @@ void Chart::LoadDevices(std::vector<BaseDevice const*> const& devices)
             m_chart_signals.push_back(std::make_shared<ChartSignal>(m_chart_rect));
             m_chart_signals.back()->Name(n.name());
             m_chart_signals.back()->MaxVal(m_max_val);
-            if (n.buffer().size() > 0) {
-                std::vector<float> buf(n.buffer().begin(), n.buffer().end());
-                ConvertData(buf);
-                m_chart_signals.back()->Append(buf);
-            }
+            m_chart_signals.back()->Source(n.shared_buffer(), [](const uint32_t* raw, float* out, size_t count) {
+                Conversion::NtcTemperature(raw, out, count);
+            });
+            m_chart_signals.back()->Statistics(n.shared_statistics());
+            m_chart_signals.back()->Time(d->SharedTimeColumn(), d->GetSamplingPeriod());
         }
     }
+    m_samples_per_pixel = 1;
+    m_start_ms          = 0;
+    m_follow            = true;
     CreateAxisMarkers();
-    SetAxisX(m_chart_signals.front()->GetDrawIndex());
+    UpdateView();
     signal_chart_signals_configured(m_chart_signals);
 }
 
-void Chart::Update(std::vector<BaseDevice const*> const& devices)
+void Chart::Update()
 {
-    auto it = m_chart_signals.begin();
-    for (auto& d : devices) {
-        for (auto& n : d->GetNodes()) {
-            auto vec = std::vector<float>(n.buffer().end() - (n.buffer().size() - (*it)->Data().size()), n.buffer().end());
+    for (auto& cs : m_chart_signals)
+        cs->Update();
 
-            ConvertData(vec);
+    UpdateView();
+}
 
-            (*it)->Append(vec);
-            it++;
-        }
+// All signals share the time axis, devices sampled at different rates line up by time and every signal is
+// drawn from its own samples
+void Chart::UpdateView()
+{
+    if (m_chart_signals.empty())
+        return;
+
+    if (m_follow) {
+        uint32_t last = 0;
+        for (auto& cs : m_chart_signals)
+            last = std::max(last, cs->LastTime());
+        auto window = static_cast<uint32_t>(m_chart_rect.width * MsPerPixel());
+        m_start_ms  = last > window ? last - window : 0;
     }
 
-    SetAxisX(m_chart_signals.front()->GetDrawIndex());
+    // Curves are rebuilt in parallel, every one reads and converts the visible samples of its own node
+    TaskGroup group;
+    group.ParallelFor(m_chart_signals.size(), [&](size_t i) { m_chart_signals[i]->SetView(m_start_ms, MsPerPixel()); });
+
+    SetAxisX(m_start_ms);
 }
 
 void Chart::AddChartSignal(std::shared_ptr<ChartSignal> const& csignal)
@@ -270,7 +299,7 @@ void Chart::CreateAxisX()
         marker.setFillColor(sf::Color::Black);
         marker.setCharacterSize(18);
         // X markers will be in minutes
-        float tmpf = i * ((static_cast<float>(m_sampling_period_ms) / (60 * 1000)) * m_chart_rect.width) / (n - 1);
+        float tmpf = i * ((static_cast<float>(m_sampling_period_ms) / (60 * 1000)) * m_chart_rect.width * m_samples_per_pixel) / (n - 1);
         int   tmpi = std::floor(tmpf);
         marker.setString(std::to_string(tmpi));
         marker.setOrigin(marker.getLocalBounds().left + marker.getLocalBounds().width / 2.f,
@@ -279,14 +308,16 @@ void Chart::CreateAxisX()
     }
 }
 
-void Chart::SetAxisX(int startx)
+void Chart::SetAxisX(uint32_t start_ms)
 {
+    float start_min = start_ms / (60.f * 1000.f);
+
     for (int i = 0; i < m_x_axis_markers.size(); ++i) {
         auto& marker = m_x_axis_markers[i];
         // X markers will be in minutes
         // If e.g. sampling period is 3.6s, then with graph region width = 1000, we have exactly 1 hour long graphing region.
-        float tmpf = startx * (static_cast<float>(m_sampling_period_ms) / (60 * 1000)) +
-                     i * ((static_cast<float>(m_sampling_period_ms) / (60 * 1000)) * m_chart_rect.width) / (m_x_axis_markers.size() - 1);
+        float tmpf = start_min +
+                     i * ((static_cast<float>(m_sampling_period_ms) / (60 * 1000)) * m_chart_rect.width * m_samples_per_pixel) / (m_x_axis_markers.size() - 1);
         int tmpi = std::floor(tmpf);
         marker.setString(std::to_string(tmpi));
     }
@@ -305,33 +336,127 @@ void Chart::OnKeyPress(const chart_callback_type& f)
 void Chart::SetDrawChartSignal(int idx, bool on)
 {
     if (idx >= 0 && idx < m_chart_signals.size())
-        m_chart_signals[idx]->enabled = on;
+        m_chart_signals[idx]->Enabled(on);
 }
 
 bool Chart::ToggleDrawChartSignal(int idx)
 {
     if (idx >= 0 && idx < m_chart_signals.size())
-        m_chart_signals[idx]->enabled = !m_chart_signals[idx]->enabled;
+        m_chart_signals[idx]->Enabled(!m_chart_signals[idx]->Enabled());
 
-    return m_chart_signals[idx]->enabled;
+    return m_chart_signals[idx]->Enabled();
 }
 
 bool Chart::ToggleDrawAllChartSignals()
 {
     m_draw_all_chart_signals = !m_draw_all_chart_signals;
     for (auto& sig : m_chart_signals)
-        sig->enabled = m_draw_all_chart_signals;
+        sig->Enabled(m_draw_all_chart_signals);
 
     return m_draw_all_chart_signals;
 }
 
+bool Chart::ToggleProfilerOverlay()
+{
+    m_show_profiler = !m_show_profiler;
+    if (m_show_profiler)
+        m_profiler_last_update = {};
+    UpdateProfilerOverlay();
+
+    return m_show_profiler;
+}
+
+// Text is rebuilt a few times per second only, so the overlay doesn't show up in its own draw timings
+void Chart::UpdateProfilerOverlay()
+{
+    using namespace std::chrono_literals;
+
+    if (!m_show_profiler)
+        return;
+
+    auto now = std::chrono::steady_clock::now();
+    if (now - m_profiler_last_update < 250ms)
+        return;
+    m_profiler_last_update = now;
+
+    m_profiler_text.setString(Profiler::Get().Report());
+    auto bounds = m_profiler_text.getGlobalBounds();
+    m_profiler_background.setSize(sf::Vector2f(bounds.width + 10.f, bounds.height + 15.f));
+}
+
+bool Chart::ToggleStatisticsOverlay()
+{
+    m_show_statistics = !m_show_statistics;
+    if (m_show_statistics)
+        m_statistics_last_update = {};
+    UpdateStatisticsOverlay();
+
+    return m_show_statistics;
+}
+
+// Statistics of the drawn signals, in the top right corner. Reading them doesn't touch the samples.
+void Chart::UpdateStatisticsOverlay()
+{
+    using namespace std::chrono_literals;
+
+    if (!m_show_statistics)
+        return;
+
+    auto now = std::chrono::steady_clock::now();
+    if (now - m_statistics_last_update < 250ms)
+        return;
+    m_statistics_last_update = now;
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1);
+    for (auto const& cs : m_chart_signals) {
+        if (!cs->Enabled() || !cs->Statistics())
+            continue;
+        auto s = cs->Statistics()->Get();
+        ss << cs->Name() << "  min " << s.min << "  max " << s.max << "  mean " << s.mean << "  sd " << s.stdev;
+        for (auto const& w : s.windows)
+            ss << "  | " << w.name << " " << w.min << " / " << w.mean << " / " << w.max;
+        ss << "\n";
+    }
+
+    auto str = ss.str();
+    if (!str.empty())
+        str.pop_back();
+    m_statistics_text.setString(str);
+    auto bounds = m_statistics_text.getLocalBounds();
+    auto left   = m_chart_rect.left + m_chart_rect.width - bounds.width - 15.f;
+    m_statistics_text.setPosition(left + 5.f, m_chart_rect.top + 10.f);
+    m_statistics_background.setPosition(left, m_chart_rect.top + 5.f);
+    m_statistics_background.setSize(sf::Vector2f(bounds.width + 10.f, bounds.height + 15.f));
+}
+
 void Chart::ClearChartSignals()
 {
     for (auto& cs : m_chart_signals)
         cs->Clear();
+
+    m_start_ms = 0;
+    m_follow   = true;
 }
 
 void Chart::SetSamplingPeriod(uint32_t sampling_period_ms)
 {
     m_sampling_period_ms = sampling_period_ms;
-}
\ No newline at end of file
+}
+
+void Chart::SetTimeWindow(float from_min, float to_min)
+{
+    if (m_sampling_period_ms <= 0 || to_min <= from_min)
+        return;
+
+    const float samples_per_min = 60.f * 1000.f / m_sampling_period_ms;
+    int         count           = static_cast<int>((to_min - from_min) * samples_per_min);
+    int         width           = static_cast<int>(m_chart_rect.width);
+
+    m_samples_per_pixel = std::max(1, (count + width - 1) / width);
+    m_start_ms          = static_cast<uint32_t>(from_min * 60.f * 1000.f);
+    m_follow            = false;
+
+    CreateAxisX();
+    UpdateView();
+}
@@ -0,0 +1,74 @@
+#include "ClockFit.hpp"
+#include <algorithm>
+
+Serializer::ser_data_t ClockFit::Serialize() const
+{
+    ser_data_t data;
+    if (m_n == 0)
+        return data;
+
+    Serializer::append(data, "clock");
+    Serializer::append(data, *m_base_id);
+    Serializer::append(data, m_offset);
+    Serializer::append(data, m_skew);
+    Serializer::append(data, m_n);
+    Serializer::append(data, m_begin.value_or(0), "\n");
+    return data;
+}
+
+void ClockFit::Deserialize(ser_data_t& data)
+{
+    auto                     newline_it = std::find(data.begin(), data.end(), '\n');
+    std::string              str(data.begin(), newline_it);
+    std::istringstream       ss(str);
+    std::string              str_tok;
+    std::vector<std::string> tokens;
+
+    while (std::getline(ss, str_tok, Serializer::Delim[0]))
+        tokens.push_back(str_tok);
+
+    if ((tokens.size() != 5 && tokens.size() != 6) || tokens[0] != "clock")
+        return; // line is left for whoever it belongs to
+
+    Reset();
+    if (tokens.size() == 6)
+        m_begin = std::stoull(tokens[5]);
+    m_base_id = static_cast<uint32_t>(std::stoul(tokens[1]));
+    m_offset  = std::stod(tokens[2]);
+    m_skew    = std::stod(tokens[3]);
+    m_n       = std::stoull(tokens[4]);
+
+    data = ser_data_t(newline_it == data.end() ? data.end() : newline_it + 1, data.end());
+}
+
+void ClockFit::Add(uint32_t packet_id, double host_ms)
+{
+    if (m_base_id && static_cast<int32_t>(packet_id - m_last_id) < 0)
+        *this = ClockFit(m_begin.value_or(0));
+    if (!m_base_id)
+        m_base_id = packet_id;
+    m_last_id = packet_id;
+
+    double x  = X(packet_id);
+    double dx = x - m_mean_x;
+    ++m_n;
+    m_mean_x += dx / m_n;
+    m_mean_y += (host_ms - m_mean_y) / m_n;
+    m_sxx += dx * (x - m_mean_x);
+    m_sxy += dx * (host_ms - m_mean_y);
+
+    if (m_sxx > 0) {
+        m_skew   = m_sxy / m_sxx;
+        m_offset = m_mean_y - m_skew * m_mean_x;
+    }
+}
+
+double ClockFit::Map(uint32_t packet_id) const
+{
+    return m_base_id ? m_offset + m_skew * X(packet_id) : 0.;
+}
+
+void ClockFit::Reset()
+{
+    *this = ClockFit();
+}
@@ -0,0 +1,46 @@
+#include "Conversion.hpp"
+#include "Profiler.hpp"
+#include <array>
+#include <cmath>
+
+namespace Conversion
+{
+float NtcTemperature(float y)
+{
+    // Calculate degrees from raw data
+    // NTC equation
+    //const float vcc   = 3.0;
+    //const float r1    = 5600.f;
+    const float beta = 4920.f; // datasheet
+    //const float rntc0 = 33000.f;
+    //const float t0    = 298.15; // 25 *C
+    //const float rinf  = rntc0 * std::exp(-beta / t0);
+
+    //auto vntc = vcc * y / 4096.f;
+    // Vntc = Vcc * Rntc / (R1 + Rntc);
+    // Vntc * R1 + Vntc * Rntc = Vcc * Rntc
+    // Rntc * (Vcc - Vntc) = Vntc * R1
+    // Rntc = Vntc / (Vcc - Vntc) * R1;
+    //float rntc = vntc / (vcc - vntc) * r1;
+
+    // Temperature: Tntc = beta / (ln(Rntc/Rinf))
+    //y = beta / std::log(rntc / rinf) - 273.15;
+
+    // Using Wolfram alpha I simplified the equation. Notice Vcc is not used, since to calculate rntc we only need the adc ratio value, no the absolute.
+    return beta / (std::log(-y / (y - 4096.f)) + 14.728) - 273.15;
+}
+
+void NtcTemperature(const uint32_t* raw, float* out, size_t n)
+{
+    static const auto table = [] {
+        std::array<float, 4096> t;
+        for (size_t i = 0; i < t.size(); ++i)
+            t[i] = NtcTemperature(static_cast<float>(i));
+        return t;
+    }();
+
+    Profiler::ScopedTimer timer(Profiler::Stage::Conversion);
+    for (size_t i = 0; i < n; ++i)
+        out[i] = raw[i] < table.size() ? table[raw[i]] : NtcTemperature(static_cast<float>(raw[i]));
+}
+} // namespace Conversion
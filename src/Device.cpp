@@ -1,13 +1,56 @@
 #include "Device.hpp"
+#include "AllocCounter.hpp"
 #include "Helpers.hpp"
+#include "Profiler.hpp"
+#include "TaskPool.hpp"
 #include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <future>
 #include <iostream>
 #include <thread>
 
 using namespace std::chrono_literals;
 
+namespace
+{
+// Packet id jumps are gaps only as long as the time since the last packet explains them, give or take this much
+constexpr uint32_t MaxGapSlackMs = 1000;
+constexpr uint32_t MaxGapPackets = 1 << 20; // if the sampling period isn't known
+} // namespace
+
+std::optional<DataPacket::View> DataPacket::Parse(const uint8_t* data, size_t size, size_t& consumed)
+{
+    for (size_t i = 0; i + sizeof(HEADER_START_ID) <= size; ++i) {
+        uint32_t id;
+        memcpy(&id, &data[i], sizeof(id));
+        if (id != HEADER_START_ID)
+            continue;
+
+        consumed = i; // everything before the header is garbage
+        if (size - i < sizeof(Header))
+            return std::nullopt; // header not received yet
+
+        View view;
+        memcpy(&view.header, &data[i], sizeof(Header));
+        if (view.header.payload_size > MAX_PAYLOAD_SIZE)
+            continue; // start id was part of some other data
+
+        size_t payload_idx = i + sizeof(Header);
+        if (size - payload_idx < view.header.payload_size)
+            return std::nullopt; // payload not received yet
+
+        view.payload     = &data[payload_idx];
+        view.payload_len = view.header.payload_size / sizeof(uint32_t);
+        consumed         = payload_idx + view.header.payload_size;
+        return view;
+    }
+
+    // Keep the last bytes, they could be the beginning of a start id
+    consumed = size < sizeof(HEADER_START_ID) ? 0 : size - (sizeof(HEADER_START_ID) - 1);
+    return std::nullopt;
+}
+
 std::optional<DataPacket> DataPacket::Extract(const uint8_t* data, size_t size, int& remaining_size)
 {
     if (size <= sizeof(Header)) // only header, we also need data
@@ -53,8 +96,26 @@ Serializer::ser_data_t Node::Serialize() const
     ser_data_t data;
     Serializer::append(data, "node");
     Serializer::append(data, m_name);
-    for (auto x : m_buffer)
-        Serializer::append(data, x);
+    // A gap is written as a single '~<length>' token
+    auto write = [&](auto tag) {
+        std::vector<decltype(tag)> chunk(Store::BlockSize);
+        size_t                     pos  = 0;
+        auto                       upto = [&](size_t end) {
+            for (size_t n; pos < end && (n = m_buffer->Read(pos, std::min(chunk.size(), end - pos), chunk.data())) > 0; pos += n)
+                for (size_t j = 0; j < n; ++j)
+                    Serializer::append(data, chunk[j]);
+        };
+        for (auto const& gap : m_buffer->Gaps()) {
+            upto(gap.begin);
+            Serializer::append(data, "~" + std::to_string(gap.length));
+            pos += gap.length;
+        }
+        upto(m_buffer->size());
+    };
+    if (m_buffer->Width() == SampleWidth::F32)
+        write(float{});
+    else
+        write(uint32_t{});
     data.pop_back();
     Serializer::append(data, "\n", "");
     return data;
@@ -74,21 +135,61 @@ void Node::Deserialize(ser_data_t& data)
 
     if (tokens.size() > 2 && tokens[0] == "node") {
         m_name = tokens[1];
-        m_buffer.clear();
-        auto beg = tokens.begin() + 2;
-        for (auto it = beg; it != tokens.end(); ++it)
-            m_buffer.push_back(std::stoi(*it));
+        m_buffer->clear();
+        // Integers unless there is a value with a fraction or exponent, gaps ('~<length>') come between the values
+        bool is_float = std::any_of(tokens.begin() + 2, tokens.end(), [](std::string const& tok) {
+            return tok[0] != '~' && tok.find_first_not_of("0123456789") != std::string::npos;
+        });
+        auto read = [&](auto tag, auto convert) {
+            std::vector<decltype(tag)> values;
+            values.reserve(tokens.size() - 2);
+            for (auto it = tokens.begin() + 2; it != tokens.end(); ++it) {
+                if ((*it)[0] == '~') {
+                    m_buffer->append(values);
+                    m_buffer->append_gap(std::stoul(it->substr(1)));
+                    values.clear();
+                } else {
+                    values.push_back(convert(*it));
+                }
+            }
+            m_buffer->append(values);
+        };
+        if (is_float)
+            read(float{}, [](std::string const& tok) { return std::stof(tok); });
+        else
+            read(uint32_t{}, [](std::string const& tok) { return static_cast<uint32_t>(std::stoul(tok)); });
     }
 
     data = ser_data_t(newline_it + 1 /* skip newline */, data.end());
 }
 
+void Node::sample_width(SampleWidth width)
+{
+    std::shared_ptr<Store> store = Store::Create(width);
+    Store::Copy(*m_buffer, *store);
+    m_buffer = store;
+}
+
+void BaseDevice::SetSampleWidth(SampleWidth width)
+{
+    m_sample_width = width;
+    for (auto& n : m_nodes)
+        n.sample_width(width);
+}
+
 Serializer::ser_data_t BaseDevice::Serialize() const
 {
     ser_data_t data;
     Serializer::append(data, "device");
     Serializer::append(data, m_id);
     Serializer::append(data, m_name, "\n");
+    if (GetSamplingPeriod() > 0) {
+        Serializer::append(data, "sampling_period");
+        Serializer::append(data, GetSamplingPeriod(), "ms\n");
+    }
+    Serializer::append(data, m_time->Serialize());
+    for (auto const& c : m_clocks)
+        Serializer::append(data, c.Serialize());
     for (auto const& n : m_nodes)
         Serializer::append(data, n.Serialize());
     return data;
@@ -112,9 +213,99 @@ void BaseDevice::Deserialize(ser_data_t& data)
     }
 
     data = ser_data_t(newline_it + 1 /* skip newline */, data.end());
-    // Check if entry is for a node or a new device
-    while (std::string(data.begin(), std::find(data.begin(), data.end(), ',')) == "node")
-        m_nodes.emplace_back().Deserialize(data);
+    // Captures made before devices had their own period use the one from the file header
+    if (std::string(data.begin(), std::find(data.begin(), data.end(), ',')) == "sampling_period") {
+        newline_it = std::find(data.begin(), data.end(), '\n');
+        auto comma = std::find(data.begin(), newline_it, ',');
+        SetSamplingPeriod(std::stoi(std::string(comma + 1, newline_it)));
+        data = ser_data_t(newline_it == data.end() ? newline_it : newline_it + 1, data.end());
+    }
+    if (std::string(data.begin(), std::find(data.begin(), data.end(), ',')) == "time")
+        m_time->Deserialize(data);
+    while (std::string(data.begin(), std::find(data.begin(), data.end(), ',')) == "clock") {
+        ClockFit fit;
+        fit.Deserialize(data);
+        if (fit.Observations() == 0)
+            break; // malformed, left for the node lines check
+        m_clocks.push_back(fit);
+    }
+    ApplyClock();
+    // Check if entry is for a node or a new device. Node lines are split off first and parsed in parallel.
+    std::vector<ser_data_t> lines;
+    auto                    it = data.begin();
+    while (std::string(it, std::find(it, data.end(), ',')) == "node") {
+        auto end = std::find(it, data.end(), '\n');
+        lines.emplace_back(it, end).push_back('\n');
+        it = end == data.end() ? end : end + 1;
+    }
+    data = ser_data_t(it, data.end());
+
+    auto first = m_nodes.size();
+    m_nodes.resize(first + lines.size());
+    TaskGroup group;
+    group.ParallelFor(lines.size(), [&](size_t i) { m_nodes[first + i].Deserialize(lines[i]); });
+}
+
+// Receive times are replaced by the fitted host time of their packet ids, which lines up devices to well below a
+// sample. Every fit only times the entries of its own segment. Segments in which the ids go backwards anyway (not what
+// the fit saw) and ones without a valid fit keep their receive times.
+void BaseDevice::ApplyClock()
+{
+    if (m_clocks.empty() || m_time->empty())
+        return;
+
+    std::vector<TimeColumn::Entry> entries(m_time->size());
+    m_time->Read(0, entries.size(), entries.data());
+    auto backwards = [&](size_t i) { return static_cast<int32_t>(entries[i].packet_id - entries[i - 1].packet_id) < 0; };
+
+    std::vector<uint32_t> times(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i)
+        times[i] = entries[i].time_ms;
+
+    bool retimed = false;
+    for (size_t s = 0; s < m_clocks.size(); ++s) {
+        auto const& fit = m_clocks[s];
+        auto        end = s + 1 < m_clocks.size() ? m_clocks[s + 1].Begin().value_or(entries.size()) : entries.size();
+        end             = std::min(end, entries.size());
+        // Captures made before segments were stored have a single fit of the last segment, it starts at its base id
+        auto begin = fit.Begin().value_or(end);
+        if (!fit.Begin())
+            while (begin > 0 && static_cast<int32_t>(entries[begin - 1].packet_id - *fit.BaseId()) >= 0 &&
+                   (begin == end || !backwards(begin)))
+                --begin;
+        if (!fit.Valid() || begin >= end)
+            continue;
+        bool monotonic = true;
+        for (auto i = begin + 1; i < end && monotonic; ++i)
+            monotonic = !backwards(i);
+        if (!monotonic)
+            continue;
+        for (auto i = begin; i < end; ++i)
+            times[i] = static_cast<uint32_t>(std::max(0., std::round(fit.Map(entries[i].packet_id))));
+        retimed = true;
+    }
+    if (!retimed)
+        return;
+
+    // Fitted and received times meet at segment borders, they must not go backwards there
+    for (size_t i = 1; i < times.size(); ++i)
+        times[i] = std::max(times[i], times[i - 1]);
+    m_time->Retime(0, entries.size(), [&](size_t i, TimeColumn::Entry const&) { return times[i]; });
+}
+
+void BaseDevice::BeginClockSegment()
+{
+    // A segment without observations has no entries yet, it is moved instead of leaving an empty one behind
+    if (!m_clocks.empty() && m_clocks.back().Observations() == 0)
+        m_clocks.pop_back();
+    m_clocks.emplace_back(m_time->size());
+}
+
+ClockFit& BaseDevice::Clock()
+{
+    if (m_clocks.empty())
+        BeginClockSegment();
+    return m_clocks.back();
 }
 
 PhysicalDevice::PhysicalDevice()
@@ -170,8 +361,10 @@ bool PhysicalDevice::TryConnect()
             Stop();
             auto tok = m_serial_socket->WriteAndTokenizeResult("ID_G\n");
             if (tok.size() == 2 && tok.at(0) == "ID_G")
-                if (auto id = std::stoi(tok[1]); id == m_id)
+                if (auto id = std::stoi(tok[1]); id == m_id) {
                     m_connected = true;
+                    m_port      = p;
+                }
 
         } else {
             std::cout << "Can't connect to " << p << "!\n";
@@ -211,13 +404,54 @@ PhysicalDevice::~PhysicalDevice()
     Disconnect();
 }
 
-void PhysicalDevice::SetSamplingPeriod(uint32_t period_ms) const
+uint32_t PhysicalDevice::GetSamplingPeriod() const
 {
-    auto cmd = "PRDS," + std::to_string(period_ms) + "\n";
+    return m_sampling_period_ms * (m_filter ? m_filter->Settings().decimation : 1);
+}
+
+void PhysicalDevice::SendSamplingPeriod()
+{
+    auto cmd = "PRDS," + std::to_string(m_sampling_period_ms) + "\n";
     m_serial_socket->Write(cmd);
     m_serial_socket->ConfirmTransmission(cmd);
 }
 
+void PhysicalDevice::SetTimeOrigin(std::chrono::steady_clock::time_point origin)
+{
+    m_time_origin  = origin;
+    m_last_time_ms = 0;
+    BeginClockSegment();
+}
+
+void PhysicalDevice::Drop()
+{
+    try {
+        m_serial_socket->Disconnect();
+    } catch (std::exception const& e) {
+        std::cerr << "Error closing port of device ID:" << m_id << " " << e.what() << "\n";
+    }
+    m_raw_buffer.clear();
+    m_prev_packet_id = std::nullopt;
+    if (m_filter)
+        m_filter->Reset();
+    m_outage    = m_outage || m_running;
+    m_connected = false;
+    m_running   = false;
+}
+
+bool PhysicalDevice::SameConfig(PhysicalDevice const& other) const
+{
+    if (m_id != other.m_id || m_name != other.m_name || m_sample_width != other.m_sample_width ||
+        m_sampling_period_ms != other.m_sampling_period_ms || m_filter_settings != other.m_filter_settings ||
+        m_nodes.size() != other.m_nodes.size())
+        return false;
+
+    for (size_t i = 0; i < m_nodes.size(); ++i)
+        if (m_nodes[i].name() != other.m_nodes[i].name())
+            return false;
+    return true;
+}
+
 void PhysicalDevice::Start()
 {
     auto cmd = "STRT\n";
@@ -260,6 +494,8 @@ void PhysicalDevice::Stop()
 
     // Reset m_prev_packet_id since we lost some while stopping device
     m_prev_packet_id = std::nullopt;
+    if (m_filter)
+        m_filter->Reset();
 
     m_running = false;
 }
@@ -273,25 +509,191 @@ int PhysicalDevice::ReadData()
     int cnt = 0;
 
     if (auto size = m_serial_socket->GetRxBufferLen(); size > 0) {
-        decltype(m_raw_buffer) vec;
-        m_serial_socket->Read(vec, size);
-        m_raw_buffer.insert(m_raw_buffer.end(), vec.begin(), vec.end());
-        for (auto dp = DataPacket::Extract(m_raw_buffer); dp; dp = DataPacket::Extract(m_raw_buffer)) {
-            if (dp->payload.size() != m_nodes.size())
-                throw std::length_error("Payload length " + std::to_string(dp->payload.size()) +
-                                        " is not equal to nodes size " + std::to_string(m_nodes.size()));
+        auto& profiler    = Profiler::Get();
+        auto  allocations = AllocCounter::Thread();
+        {
+            // Receive straight into the buffer, its capacity is kept between reads so it doesn't allocate once warmed up
+            Profiler::ScopedTimer timer(Profiler::Stage::SerialRead);
+            auto                  old_size = m_raw_buffer.size();
+            m_raw_buffer.resize(old_size + size);
+            auto read = m_serial_socket->Read(m_raw_buffer.data() + old_size, size);
+            m_raw_buffer.resize(old_size + read);
+            profiler.Add(Profiler::Counter::Bytes, read);
+        }
 
-            if (m_prev_packet_id && dp->header.packet_id != *m_prev_packet_id + 1)
-                std::cout << "Missed packet! Expected packet id:" << *m_prev_packet_id + 1 << " received id:" << dp->header.packet_id << "\n";
+        Profiler::ScopedTimer timer(Profiler::Stage::PacketExtract);
+        // Packets are decoded in place, consumed bytes are dropped once for the whole read
+        m_packets.clear();
+        size_t offset = 0;
+        for (size_t consumed = 0;; offset += consumed) {
+            auto dp = DataPacket::Parse(m_raw_buffer.data() + offset, m_raw_buffer.size() - offset, consumed);
+            if (!dp) {
+                offset += consumed;
+                break;
+            }
+
+            if (dp->payload_len != m_nodes.size()) {
+                m_raw_buffer.erase(m_raw_buffer.begin(), m_raw_buffer.begin() + offset + consumed);
+                throw std::length_error("Payload length " + std::to_string(dp->payload_len) +
+                                        " is not equal to nodes size " + std::to_string(m_nodes.size()));
+            }
 
-            m_prev_packet_id = dp->header.packet_id;
+            m_packets.push_back(*dp);
+        }
 
-            for (int i = 0; i < dp->payload.size(); ++i)
-                m_nodes[i].push_back(dp->payload[i]);
+        // Reserved for all packets of the read, so pushing doesn't allocate
+        m_columns.resize(m_nodes.size() + 2);
+        for (auto& c : m_columns) {
+            c.clear();
+            c.reserve(m_packets.size());
+        }
+        auto& times      = m_columns[m_nodes.size()];
+        auto& packet_ids = m_columns[m_nodes.size() + 1];
+
+        // All packets of a read arrive together, so the last one gets the receive time and earlier ones are spaced
+        // back from it by their packet ids. Once the clock fit of the segment has enough arrivals, times come from it
+        // instead. Times never go below the last stored one.
+        auto    now_ms       = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_time_origin).count();
+        int64_t last_id      = m_packets.empty() ? 0 : m_packets.back().header.packet_id;
+        auto    receive_time = [&](uint32_t id) {
+            auto&   clock  = Clock();
+            int64_t t      = clock.Valid() ? std::llround(clock.Map(id)) : now_ms - (last_id - static_cast<int64_t>(id)) * m_sampling_period_ms;
+            m_last_time_ms = std::max<int64_t>({std::min<int64_t>(t, now_ms), m_last_time_ms, 0});
+            return static_cast<uint32_t>(m_last_time_ms);
+        };
+
+        // Time since the last packet, stored or still in the columns
+        auto elapsed_ms = [&](uint32_t time_ms) {
+            uint32_t last = !times.empty() ? times.back() : m_time->empty() ? time_ms : m_time->back().time_ms;
+            return time_ms - std::min(time_ms, last);
+        };
+
+        size_t store_allocations = 0;
+        for (auto const& dp : m_packets) {
+            auto time_ms = receive_time(dp.header.packet_id);
+
+            // First packet after the device was dropped while running, the outage becomes a gap as long as the
+            // number of samples the device would have sent meanwhile
+            if (m_outage) {
+                m_outage = false;
+                if (!m_time->empty() && m_sampling_period_ms > 0) {
+                    auto elapsed = elapsed_ms(time_ms);
+                    if (auto missed = elapsed / m_sampling_period_ms; missed > 1) {
+                        std::cout << "Device ID:" << m_id << " was gone for " << elapsed << "ms\n";
+                        store_allocations += StoreColumns();
+                        StoreGap(missed - 1);
+                    }
+                }
+            }
+
+            if (m_prev_packet_id && dp.header.packet_id != *m_prev_packet_id + 1) {
+                std::cout << "Missed packet! Expected packet id:" << *m_prev_packet_id + 1 << " received id:" << dp.header.packet_id << "\n";
+                if (static_cast<int32_t>(dp.header.packet_id - *m_prev_packet_id) < 0) {
+                    // Firmware restarted counting, the ids that follow need a fit of their own
+                    store_allocations += StoreColumns();
+                    BeginClockSegment();
+                    time_ms = receive_time(dp.header.packet_id);
+                } else if (dp.header.packet_id > *m_prev_packet_id) {
+                    uint32_t missed = dp.header.packet_id - *m_prev_packet_id - 1;
+                    // A jump longer than the time since the last packet explains (a corrupted or wrapped id) is a
+                    // resync, the gap is as long as that time, like after an outage
+                    auto elapsed = elapsed_ms(time_ms);
+                    bool resync  = false;
+                    auto max     = m_sampling_period_ms > 0 ? (elapsed + MaxGapSlackMs) / m_sampling_period_ms : MaxGapPackets;
+                    if (missed > max) {
+                        std::cout << "Device ID:" << m_id << " packet id jumped by " << missed << " in " << elapsed << "ms, resyncing\n";
+                        missed = m_sampling_period_ms > 0 ? elapsed / m_sampling_period_ms : 0;
+                        missed = missed > 0 ? missed - 1 : 0;
+                        resync = true;
+                    }
+                    profiler.Add(Profiler::Counter::MissedPackets, missed);
+                    store_allocations += StoreColumns();
+                    StoreGap(missed);
+                    if (resync) {
+                        BeginClockSegment();
+                        time_ms = receive_time(dp.header.packet_id);
+                    }
+                }
+            }
+
+            m_prev_packet_id = dp.header.packet_id;
+
+            // Transpose into columns, so every node store is appended to (and narrowed) once per read
+            for (size_t i = 0; i < dp.payload_len; ++i)
+                m_columns[i].push_back(dp[i]);
+            times.push_back(time_ms);
+            packet_ids.push_back(dp.header.packet_id);
 
             cnt++;
         }
+        m_raw_buffer.erase(m_raw_buffer.begin(), m_raw_buffer.begin() + offset);
+        profiler.Add(Profiler::Counter::Packets, cnt);
+        if (!m_packets.empty())
+            Clock().Add(m_packets.back().header.packet_id, now_ms);
+
+        store_allocations += StoreColumns();
+        profiler.Add(Profiler::Counter::IngestAllocations, AllocCounter::Thread() - allocations - store_allocations);
     }
 
     return cnt;
 }
+
+// Filter the columns collected so far and append them to the nodes and the time column. Returns the number of
+// allocations made by the stores (they allocate a new block every BlockSize samples), those aren't counted as ingest ones.
+size_t PhysicalDevice::StoreColumns()
+{
+    if (m_columns.empty() || m_columns.back().empty())
+        return 0;
+
+    // Time and packet id columns are decimated along, so they stay aligned with the samples
+    if (m_filter)
+        m_filter->Process(m_columns, m_nodes.size());
+
+    auto allocations = AllocCounter::Thread();
+    for (size_t i = 0; i < m_nodes.size(); ++i)
+        if (!m_columns[i].empty())
+            m_nodes[i].append(m_columns[i]);
+    auto const& times      = m_columns[m_nodes.size()];
+    auto const& packet_ids = m_columns[m_nodes.size() + 1];
+    m_time->append(times.data(), packet_ids.data(), times.size());
+    allocations = AllocCounter::Thread() - allocations;
+
+    for (auto& c : m_columns)
+        c.clear();
+    return allocations;
+}
+
+// Missed packets become a gap of every node, so later samples keep their index (and stay aligned with other
+// devices). The time column gets a gap too, its times are spread evenly up to the next packet when read.
+void PhysicalDevice::StoreGap(uint32_t missed)
+{
+    // The median window doesn't reach across the gap, an incomplete decimation group before it is dropped
+    if (m_filter)
+        m_filter->Reset();
+
+    if (m_time->empty())
+        return; // nothing stored since the last clear, there is nothing to keep aligned with
+
+    int    decimation = m_filter ? m_filter->Settings().decimation : 1;
+    size_t n          = (missed + decimation / 2) / decimation;
+    if (n == 0)
+        return;
+
+    for (auto& node : m_nodes)
+        node.append_gap(n);
+    m_time->append_gap(n);
+}
+
+void PhysicalDevice::SetFilter(FilterSettings const& settings)
+{
+    m_filter_settings = settings;
+    if (settings.Enabled())
+        m_filter = std::make_unique<DeviceFilter>(settings);
+    else
+        m_filter.reset();
+}
+
+std::vector<uint32_t> PhysicalDevice::RawHistory(int node) const
+{
+    return m_filter ? m_filter->RawHistory(node) : std::vector<uint32_t>{};
+}
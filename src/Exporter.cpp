@@ -0,0 +1,117 @@
+#include "Exporter.hpp"
+#include "Conversion.hpp"
+#include "Device.hpp"
+#include "Timeline.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <optional>
+
+namespace
+{
+// Converted values of the selected nodes of a device around the sample being written, samples of a device are
+// visited in order so every node is read a block at a time
+struct Column {
+    BaseDevice const*               device;
+    std::vector<Node const*>        nodes;
+    std::vector<std::vector<float>> values;
+    std::vector<size_t>             counts;
+    size_t                          begin{0};
+    bool                            loaded{false};
+    std::vector<TimeColumn::Entry>  times;
+    size_t                          n_times{0};
+
+    void Load(size_t idx, std::vector<uint32_t>& raw)
+    {
+        if (loaded && idx >= begin && idx < begin + Node::Store::BlockSize)
+            return;
+
+        begin  = idx;
+        loaded = true;
+        times.resize(Node::Store::BlockSize);
+        n_times = device->GetTimeColumn().Read(begin, times.size(), times.data());
+        for (size_t j = 0; j < nodes.size(); ++j) {
+            values[j].resize(Node::Store::BlockSize);
+            counts[j] = nodes[j]->buffer().Read(begin, raw.size(), raw.data());
+            Conversion::NtcTemperature(raw.data(), values[j].data(), counts[j]);
+            for (size_t i = 0; i < counts[j]; ++i)
+                if (raw[i] == Node::Store::Missing)
+                    values[j][i] = std::numeric_limits<float>::quiet_NaN();
+        }
+    }
+};
+} // namespace
+
+bool Exporter::WriteCsv(std::vector<BaseDevice const*> const& devices, std::string const& fname, std::vector<std::string> const& nodes)
+{
+    std::ofstream ofs(fname);
+    if (!ofs.is_open())
+        return false;
+
+    std::vector<Column> columns;
+    Timeline            timeline;
+    for (auto const* d : devices) {
+        auto& c  = columns.emplace_back();
+        c.device = d;
+        for (auto const& n : d->GetNodes())
+            if (nodes.empty() || std::find(nodes.begin(), nodes.end(), n.name()) != nodes.end())
+                c.nodes.push_back(&n);
+        c.values.resize(c.nodes.size());
+        c.counts.resize(c.nodes.size());
+
+        size_t size = 0;
+        for (auto const* n : c.nodes)
+            size = std::max(size, n->buffer().size());
+        timeline.Add(d->SharedTimeColumn(), size, d->GetSamplingPeriod());
+    }
+
+    ofs << "time_ms";
+    for (auto const& c : columns) {
+        ofs << "," << (c.device->GetName().empty() ? std::to_string(c.device->GetID()) : c.device->GetName()) << "_packet_id";
+        for (auto const* n : c.nodes)
+            ofs << "," << n->name();
+    }
+    ofs << "\n";
+
+    // Samples of all devices with the same time share a row, unless a device has more than one of them
+    std::vector<uint32_t>              raw(Node::Store::BlockSize);
+    std::vector<std::optional<size_t>> row(columns.size());
+    uint32_t                           row_time = 0;
+    auto                               flush    = [&] {
+        ofs << row_time;
+        for (size_t d = 0; d < columns.size(); ++d) {
+            auto& c = columns[d];
+            ofs << ",";
+            if (row[d] && *row[d] - c.begin < c.n_times)
+                ofs << c.times[*row[d] - c.begin].packet_id;
+            for (size_t j = 0; j < c.nodes.size(); ++j) {
+                ofs << ",";
+                if (!row[d] || *row[d] - c.begin >= c.counts[j])
+                    continue;
+                auto val = c.values[j][*row[d] - c.begin];
+                if (std::isnan(val))
+                    ofs << "NaN"; // gap
+                else
+                    ofs << val;
+            }
+            row[d] = std::nullopt;
+        }
+        ofs << "\n";
+    };
+
+    bool            pending = false;
+    Timeline::Event e;
+    while (timeline.Next(e)) {
+        if (pending && (e.time_ms != row_time || row[e.source]))
+            flush();
+        columns[e.source].Load(e.index, raw);
+        row[e.source] = e.index;
+        row_time      = e.time_ms;
+        pending       = true;
+    }
+    if (pending)
+        flush();
+
+    return static_cast<bool>(ofs);
+}
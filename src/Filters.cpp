@@ -0,0 +1,260 @@
+#include "Filters.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+// The SSE4.1 kernels are compiled for it whatever the target of the rest is, and used if the CPU has it
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SSE41_KERNELS
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define SSE41_KERNELS
+#define TARGET_SSE41
+#include <intrin.h>
+#endif
+
+#ifdef SSE41_KERNELS
+#include <smmintrin.h>
+#endif
+
+namespace Kernels
+{
+namespace
+{
+inline uint32_t Med3(uint32_t a, uint32_t b, uint32_t c)
+{
+    return std::max(std::min(a, b), std::min(std::max(a, b), c));
+}
+
+#ifdef SSE41_KERNELS
+bool HasSse41()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 19)) != 0;
+#else
+    __builtin_cpu_init(); // runs during static initialization, maybe before the one of libgcc
+    return __builtin_cpu_supports("sse4.1");
+#endif
+}
+
+bool const sse41 = HasSse41();
+
+TARGET_SSE41 inline __m128i Med3(__m128i a, __m128i b, __m128i c)
+{
+    return _mm_max_epu32(_mm_min_epu32(a, b), _mm_min_epu32(_mm_max_epu32(a, b), c));
+}
+
+// Both return the number of samples done, a multiple of 4, the rest is left to the scalar loop
+TARGET_SSE41 size_t Median3Sse41(const uint32_t* in, uint32_t* out, size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 1));
+        auto c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 2));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), Med3(a, b, c));
+    }
+    return i;
+}
+
+TARGET_SSE41 size_t Median5Sse41(const uint32_t* in, uint32_t* out, size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 1));
+        auto c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 2));
+        auto d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 3));
+        auto e = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 4));
+        auto f = _mm_max_epu32(_mm_min_epu32(a, b), _mm_min_epu32(c, d));
+        auto g = _mm_min_epu32(_mm_max_epu32(a, b), _mm_max_epu32(c, d));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), Med3(e, f, g));
+    }
+    return i;
+}
+#endif
+} // namespace
+
+void Median3(const uint32_t* in, uint32_t* out, size_t n)
+{
+#ifdef SSE41_KERNELS
+    if (sse41) {
+        size_t i = Median3Sse41(in, out, n);
+        Median3Scalar(in + i, out + i, n - i);
+        return;
+    }
+#endif
+    Median3Scalar(in, out, n);
+}
+
+void Median3Scalar(const uint32_t* in, uint32_t* out, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        out[i] = Med3(in[i], in[i + 1], in[i + 2]);
+}
+
+void Median5(const uint32_t* in, uint32_t* out, size_t n)
+{
+#ifdef SSE41_KERNELS
+    if (sse41) {
+        size_t i = Median5Sse41(in, out, n);
+        Median5Scalar(in + i, out + i, n - i);
+        return;
+    }
+#endif
+    Median5Scalar(in, out, n);
+}
+
+// Median of 5 is the median of the 5th value and the two middle candidates of the other 4
+void Median5Scalar(const uint32_t* in, uint32_t* out, size_t n)
+{
+    for (size_t i = 0; i < n; ++i) {
+        auto f = std::max(std::min(in[i], in[i + 1]), std::min(in[i + 2], in[i + 3]));
+        auto g = std::min(std::max(in[i], in[i + 1]), std::max(in[i + 2], in[i + 3]));
+        out[i] = Med3(in[i + 4], f, g);
+    }
+}
+
+size_t DecimateAverage(const uint32_t* in, size_t n, int factor, uint32_t* out)
+{
+    size_t groups = n / factor;
+    for (size_t g = 0; g < groups; ++g) {
+        uint64_t sum = 0;
+        for (int k = 0; k < factor; ++k)
+            sum += in[g * factor + k];
+        out[g] = static_cast<uint32_t>((sum + factor / 2) / factor);
+    }
+    return groups;
+}
+} // namespace Kernels
+
+DeviceFilter::DeviceFilter(FilterSettings const& settings) :
+    m_settings(settings)
+{
+    if (m_settings.median != 1 && m_settings.median != 3 && m_settings.median != 5)
+        throw std::invalid_argument("Median window must be 1, 3 or 5, not " + std::to_string(m_settings.median));
+    if (m_settings.decimation < 1)
+        throw std::invalid_argument("Decimation must be at least 1, not " + std::to_string(m_settings.decimation));
+}
+
+void DeviceFilter::Process(std::vector<std::vector<uint32_t>>& columns, size_t nodes)
+{
+    if (m_nodes.size() != columns.size())
+        m_nodes.resize(columns.size());
+
+    for (size_t i = 0; i < columns.size(); ++i) {
+        if (columns[i].empty())
+            continue;
+        if (i >= nodes) {
+            if (m_settings.decimation > 1)
+                Pick(m_nodes[i], columns[i]);
+            continue;
+        }
+        if (m_settings.raw_ring > 0)
+            KeepRaw(m_nodes[i], columns[i]);
+        if (m_settings.median > 1)
+            Median(m_nodes[i], columns[i]);
+        if (m_settings.decimation > 1)
+            Decimate(m_nodes[i], columns[i]);
+    }
+}
+
+void DeviceFilter::Reset()
+{
+    for (auto& n : m_nodes) {
+        n.primed = false;
+        n.sum    = 0;
+        n.count  = 0;
+    }
+}
+
+std::vector<uint32_t> DeviceFilter::RawHistory(size_t node) const
+{
+    if (node >= m_nodes.size())
+        return {};
+
+    auto const&           n = m_nodes[node];
+    std::vector<uint32_t> raw;
+    if (n.ring_full)
+        raw.assign(n.ring.begin() + n.ring_pos, n.ring.end());
+    raw.insert(raw.end(), n.ring.begin(), n.ring.begin() + n.ring_pos);
+    return raw;
+}
+
+// Causal median, history of the previous read is put in front of the new samples
+void DeviceFilter::Median(NodeState& state, std::vector<uint32_t>& column)
+{
+    size_t h = m_settings.median - 1;
+    if (!state.primed) {
+        state.history.fill(column.front());
+        state.primed = true;
+    }
+
+    state.scratch.resize(h + column.size());
+    std::copy(state.history.begin(), state.history.begin() + h, state.scratch.begin());
+    std::copy(column.begin(), column.end(), state.scratch.begin() + h);
+    std::copy(state.scratch.end() - h, state.scratch.end(), state.history.begin());
+
+    if (m_settings.median == 3)
+        Kernels::Median3(state.scratch.data(), column.data(), column.size());
+    else
+        Kernels::Median5(state.scratch.data(), column.data(), column.size());
+}
+
+// Samples of an incomplete group are carried over to the next read
+void DeviceFilter::Decimate(NodeState& state, std::vector<uint32_t>& column)
+{
+    const int factor = m_settings.decimation;
+    size_t    in     = 0;
+    size_t    out    = 0;
+
+    for (; state.count > 0 && in < column.size(); ++in) {
+        state.sum += column[in];
+        if (++state.count == factor) {
+            column[out++] = static_cast<uint32_t>((state.sum + factor / 2) / factor);
+            state.sum     = 0;
+            state.count   = 0;
+        }
+    }
+
+    // Output never overtakes input, so averages can be written in place
+    size_t groups = Kernels::DecimateAverage(column.data() + in, column.size() - in, factor, column.data() + out);
+    in += groups * factor;
+    out += groups;
+
+    for (; in < column.size(); ++in) {
+        state.sum += column[in];
+        state.count++;
+    }
+
+    column.resize(out);
+}
+
+// The last sample of every group is kept, so times and ids are ones of samples that were received
+void DeviceFilter::Pick(NodeState& state, std::vector<uint32_t>& column)
+{
+    size_t out = 0;
+    for (size_t in = 0; in < column.size(); ++in) {
+        if (++state.count == m_settings.decimation) {
+            column[out++] = column[in];
+            state.count   = 0;
+        }
+    }
+    column.resize(out);
+}
+
+void DeviceFilter::KeepRaw(NodeState& state, std::vector<uint32_t> const& column)
+{
+    if (state.ring.size() != m_settings.raw_ring)
+        state.ring.assign(m_settings.raw_ring, 0);
+
+    for (auto v : column) {
+        state.ring[state.ring_pos++] = v;
+        if (state.ring_pos == state.ring.size()) {
+            state.ring_pos  = 0;
+            state.ring_full = true;
+        }
+    }
+}
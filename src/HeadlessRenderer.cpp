@@ -0,0 +1,252 @@
+#include "HeadlessRenderer.hpp"
+#include "Acquisition.hpp"
+#include "Chart.hpp"
+#include "Exporter.hpp"
+#include "Helpers.hpp"
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+HeadlessRenderer::HeadlessRenderer(HeadlessOptions const& options) :
+    m_options(options)
+{
+    // Expand directories into the capture files they contain
+    std::vector<std::string> files;
+    for (auto const& f : m_options.files) {
+        if (fs::is_directory(f)) {
+            std::vector<std::string> dir_files;
+            for (auto const& entry : fs::directory_iterator(f))
+                if (entry.is_regular_file() && entry.path().extension() == ".txt")
+                    dir_files.push_back(entry.path().string());
+            std::sort(dir_files.begin(), dir_files.end());
+            files.insert(files.end(), dir_files.begin(), dir_files.end());
+        } else {
+            files.push_back(f);
+        }
+    }
+    m_options.files = files;
+
+    // Outputs are named after the file, files of the same name get their directory in front and, if that doesn't
+    // tell them apart either, an index after it
+    std::map<std::string, int> count;
+    for (auto const& f : m_options.files)
+        count[fs::path(f).stem().string()]++;
+    std::set<std::string> taken;
+    for (auto const& f : m_options.files) {
+        auto path = fs::path(f);
+        auto name = path.stem().string();
+        if (count[name] > 1) {
+            auto dir = fs::absolute(path).parent_path().filename().string();
+            name     = (dir.empty() ? "" : dir + "_") + name;
+        }
+        auto unique = name;
+        for (int n = 1; !taken.insert(unique).second; ++n)
+            unique = name + "_" + std::to_string(n);
+        m_out_names.push_back(unique);
+    }
+
+    if (m_options.jobs <= 0)
+        m_options.jobs = std::max(1u, std::thread::hardware_concurrency());
+}
+
+std::optional<HeadlessOptions> HeadlessRenderer::ParseArguments(int argc, char* argv[])
+{
+    std::vector<std::string> args(argv + 1, argv + argc);
+    if (std::find(args.begin(), args.end(), "--headless") == args.end())
+        return std::nullopt;
+
+    HeadlessOptions opts;
+    for (size_t i = 0; i < args.size(); ++i) {
+        auto const& arg   = args[i];
+        auto        value = [&]() -> std::string const& {
+            if (i + 1 >= args.size())
+                throw std::invalid_argument("Missing value for argument '" + arg + "'");
+            return args[++i];
+        };
+
+        if (arg == "--headless")
+            continue;
+        else if (arg == "--nodes")
+            opts.nodes = Help::TokenizeString(value(), ",");
+        else if (arg == "--from")
+            opts.from_min = std::stof(value());
+        else if (arg == "--to")
+            opts.to_min = std::stof(value());
+        else if (arg == "--out")
+            opts.out_dir = value();
+        else if (arg == "--width")
+            opts.width = std::stoi(value());
+        else if (arg == "--height")
+            opts.height = std::stoi(value());
+        else if (arg == "--jobs")
+            opts.jobs = std::stoi(value());
+        else if (arg == "--stats")
+            opts.stats = true;
+        else if (arg == "--csv")
+            opts.csv = true;
+        else if (arg.rfind("--", 0) == 0)
+            throw std::invalid_argument("Unknown argument '" + arg + "'");
+        else
+            opts.files.push_back(arg);
+    }
+
+    if (opts.files.empty())
+        throw std::invalid_argument("No input files given");
+
+    return opts;
+}
+
+std::string HeadlessRenderer::Usage()
+{
+    return "Usage: sample_and_graph --headless [--nodes n1,n2,...] [--from min] [--to min] [--out dir]\n"
+           "                        [--width px] [--height px] [--jobs n] [--stats] [--csv] file|dir ...\n";
+}
+
+int HeadlessRenderer::Run()
+{
+    fs::create_directories(m_options.out_dir);
+
+    std::atomic<size_t> next{0};
+    std::atomic<int>    failed{0};
+
+    auto worker = [this, &next, &failed] {
+        sf::RenderTexture texture;
+        if (!texture.create(m_options.width, m_options.height)) {
+            std::cerr << "Error: can't create render texture!\n";
+            failed++;
+            return;
+        }
+
+        for (auto i = next++; i < m_options.files.size(); i = next++) {
+            try {
+                if (!RenderFile(i, texture))
+                    failed++;
+            } catch (std::exception const& e) {
+                std::cerr << "Error rendering '" << m_options.files[i] << "': " << e.what() << "\n";
+                failed++;
+            }
+        }
+    };
+
+    int                      n_workers = std::min<int>(m_options.jobs, m_options.files.size());
+    std::vector<std::thread> workers;
+    for (int i = 0; i < n_workers; ++i)
+        workers.emplace_back(worker);
+    for (auto& w : workers)
+        w.join();
+
+    std::cout << "Rendered " << m_options.files.size() - failed << " of " << m_options.files.size() << " files to " << m_options.out_dir << "\n";
+
+    return failed;
+}
+
+bool HeadlessRenderer::RenderFile(size_t file, sf::RenderTexture& texture) const
+{
+    auto const& fname = m_options.files[file];
+    if (!fs::is_regular_file(fname)) {
+        std::cerr << "Error: can't open file '" << fname << "'!\n";
+        return false;
+    }
+
+    Acquisition acquisition;
+    ::Chart     chart(0, 0, m_options.width, m_options.height, 100, 100);
+
+    bool                           has_nodes = false;
+    std::vector<BaseDevice const*> loaded;
+    acquisition.signal_devices_loaded.connect([&](std::vector<BaseDevice const*> const& devices) {
+        loaded = devices;
+        for (auto const& d : devices)
+            has_nodes |= !d->GetNodes().empty();
+        if (!has_nodes)
+            return;
+        chart.SetSamplingPeriod(acquisition.GetSamplingPeriod());
+        chart.LoadDevices(devices);
+    });
+    acquisition.Load(fname);
+
+    if (!has_nodes) {
+        std::cerr << "Error: no nodes in '" << fname << "'!\n";
+        return false;
+    }
+
+    if (!m_options.nodes.empty()) {
+        auto const& signals = chart.ChartSignals();
+        for (size_t i = 0; i < signals.size(); ++i) {
+            bool selected = std::find(m_options.nodes.begin(), m_options.nodes.end(), signals[i]->Name()) != m_options.nodes.end();
+            chart.SetDrawChartSignal(i, selected);
+        }
+    }
+
+    if (m_options.from_min || m_options.to_min) {
+        float from = m_options.from_min.value_or(0.f);
+        float to   = m_options.to_min.value_or(from + chart.GraphRegion().width * acquisition.GetSamplingPeriod() / (60.f * 1000.f));
+        chart.SetTimeWindow(from, to);
+    }
+
+    texture.clear(sf::Color(235, 235, 235));
+    texture.draw(chart);
+    texture.display();
+
+    auto out = OutputName(file);
+    if (!texture.getTexture().copyToImage().saveToFile(out)) {
+        std::cerr << "Error: can't write '" << out << "'!\n";
+        return false;
+    }
+
+    if (m_options.stats && !WriteStatistics(chart, file))
+        return false;
+
+    // Devices are merged on their receive times, each at its own rate
+    if (m_options.csv) {
+        auto csv = OutputName(file, ".csv");
+        if (!Exporter::WriteCsv(loaded, csv, m_options.nodes)) {
+            std::cerr << "Error: can't write '" << csv << "'!\n";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// One line per selected node, statistics were gathered while loading, so this doesn't scan the samples
+bool HeadlessRenderer::WriteStatistics(::Chart const& chart, size_t file) const
+{
+    auto          out = OutputName(file, "_stats.csv");
+    std::ofstream ofs(out);
+    if (!ofs.is_open()) {
+        std::cerr << "Error: can't write '" << out << "'!\n";
+        return false;
+    }
+
+    bool header = true;
+    for (auto const& cs : chart.ChartSignals()) {
+        if (!cs->Enabled() || !cs->Statistics())
+            continue;
+        auto s = cs->Statistics()->Get();
+        if (header) {
+            ofs << "node,count,min,max,mean,stdev";
+            for (auto const& w : s.windows)
+                ofs << "," << w.name << "_min," << w.name << "_max," << w.name << "_mean";
+            ofs << "\n";
+            header = false;
+        }
+        ofs << cs->Name() << "," << s.count << "," << s.min << "," << s.max << "," << s.mean << "," << s.stdev;
+        for (auto const& w : s.windows)
+            ofs << "," << w.min << "," << w.max << "," << w.mean;
+        ofs << "\n";
+    }
+
+    return true;
+}
+
+std::string HeadlessRenderer::OutputName(size_t file, std::string const& suffix) const
+{
+    return (fs::path(m_options.out_dir) / m_out_names[file]).string() + suffix;
+}
@@ -0,0 +1,68 @@
+#include "Hotplug.hpp"
+#include <iostream>
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace
+{
+bool IsSerialPort(std::string const& name)
+{
+    return name.rfind("ttyACM", 0) == 0 || name.rfind("ttyUSB", 0) == 0;
+}
+} // namespace
+
+HotplugWatcher::HotplugWatcher()
+{
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd < 0 || inotify_add_watch(m_fd, "/dev", IN_CREATE | IN_DELETE) < 0) {
+        std::cerr << "Hot-plug detection not available (" << std::strerror(errno) << ")\n";
+        if (m_fd >= 0)
+            close(m_fd);
+        m_fd = -1;
+    }
+}
+
+HotplugWatcher::~HotplugWatcher()
+{
+    if (m_fd >= 0)
+        close(m_fd);
+}
+
+std::vector<HotplugWatcher::Event> HotplugWatcher::Poll()
+{
+    std::vector<Event> events;
+    if (m_fd < 0)
+        return events;
+
+    alignas(inotify_event) char buf[4096];
+    for (;;) {
+        auto len = read(m_fd, buf, sizeof(buf));
+        if (len <= 0)
+            break; // EAGAIN - nothing more to read
+
+        for (char* p = buf; p < buf + len;) {
+            auto* ev = reinterpret_cast<inotify_event*>(p);
+            if (ev->len > 0 && IsSerialPort(ev->name))
+                events.push_back({(ev->mask & IN_CREATE) != 0, std::string("/dev/") + ev->name});
+            p += sizeof(inotify_event) + ev->len;
+        }
+    }
+    return events;
+}
+
+#else
+
+HotplugWatcher::HotplugWatcher() {}
+
+HotplugWatcher::~HotplugWatcher() {}
+
+std::vector<HotplugWatcher::Event> HotplugWatcher::Poll()
+{
+    return {};
+}
+
+#endif
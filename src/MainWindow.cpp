@@ -1,4 +1,5 @@
 #include "MainWindow.hpp"
+#include "Profiler.hpp"
 #include <chrono>
 #include <iomanip>
 
@@ -60,16 +61,41 @@ void MainWindow::UpdateTitleBar()
     } else
         run_msec = m_total_run_time;
 
+    auto const& profiler = Profiler::Get();
+
     auto alive_sec = alive_msec / 1000;
     auto run_sec   = run_msec / 1000;
-    //auto size = ;
-    //auto capacity = ;
+    auto size      = profiler.Value(Profiler::Gauge::BufferBytes) / (1024.f * 1024.f);
+    auto budget    = profiler.Value(Profiler::Gauge::BufferBudgetBytes) / (1024.f * 1024.f);
+    auto spilled   = profiler.Value(Profiler::Gauge::SpilledBytes) / (1024.f * 1024.f);
     // Update title bar
     std::stringstream str;
     str << "Sample and Graph    alive: " << std::to_string(alive_sec / 60) << ":" << std::setw(2) << std::setfill('0') << std::to_string(alive_sec % 60)
-        << "  running: " << std::to_string(run_sec / 60) << ":" << std::setw(2) << std::setfill('0') << std::to_string(run_sec % 60); // << "   Buffer size: " << size << " MB" // Not implemented ATM
-                                                                                                                                      // << " / " << capacity << " MB";         // Not implemented ATM
+        << "  running: " << std::to_string(run_sec / 60) << ":" << std::setw(2) << std::setfill('0') << std::to_string(run_sec % 60)
+        << "   packets/s: " << static_cast<int>(profiler.Rate(Profiler::Counter::Packets))
+        << "  missed: " << profiler.Total(Profiler::Counter::MissedPackets)
+        << "   Buffer size: " << std::fixed << std::setprecision(1) << size << " MB";
+    if (budget > 0)
+        str << " / " << budget << " MB";
+    if (spilled > 0)
+        str << "  spilled: " << spilled << " MB";
     SetTitle(str.str());
+
+    chart->UpdateProfilerOverlay();
+    chart->UpdateStatisticsOverlay();
+
+    // Refresh per signal memory usage once a second
+    using namespace std::chrono_literals;
+    if (auto now = std::chrono::steady_clock::now(); now - m_signal_list_refresh > 1s) {
+        signal_list->Refresh();
+        m_signal_list_refresh = now;
+    }
+}
+
+void MainWindow::Draw()
+{
+    Profiler::ScopedTimer timer(Profiler::Stage::Draw);
+    Window::Draw();
 }
 
 MainWindow::MainWindow() :
@@ -80,31 +106,17 @@ MainWindow::MainWindow() :
     chart = std::make_shared<::Chart>(100, 10, 1120, 640, 100, 100);
 
     chart->signal_chart_signals_configured.connect([this](std::vector<std::shared_ptr<ChartSignal>> const& signals) {
-        if (checkboxes_signal_enabled.size() > 0) {
-            for (auto const& cb : checkboxes_signal_enabled)
-                Remove(cb);
-
-            checkboxes_signal_enabled.clear();
-        }
-
-        const int   spacing       = 23;
-        auto const& lowest_button = button_sel_desel_all_chkbxs;
-        const int   y_offset      = 15 + lowest_button->GetGlobalBounds().top + lowest_button->GetGlobalBounds().height;
-        int         modulo        = (m_window->getSize().y - lowest_button->GetGlobalBounds().top -
-                      lowest_button->GetGlobalBounds().height - spacing) /
-                     spacing;
-        for (int i = 0; i < signals.size(); ++i) {
-            int column = i / modulo;
-            int y      = y_offset + (i % modulo) * spacing;
-            int x      = 10 + column * 45;
-
-            checkboxes_signal_enabled.push_back(std::make_shared<mygui::Checkbox>(x, y, signals[i]->Name(), 13, 13, 13));
-            checkboxes_signal_enabled.back()->Checked(true);
-            Add(checkboxes_signal_enabled.back());
-            checkboxes_signal_enabled.back()->OnClick([this, i] {
-                chart->SetDrawChartSignal(i, checkboxes_signal_enabled.at(i)->Checked());
-            });
-        }
+        std::vector<std::string> names;
+        names.reserve(signals.size());
+        for (auto const& s : signals)
+            names.push_back(s->Name());
+        signal_list->SetSignals(names);
+    });
+
+    // F5 reconnects devices that failed or changed in config.txt, without touching the healthy ones
+    chart->OnKeyPress([this](const sf::Event& event) {
+        if (event.key.code == sf::Keyboard::F5)
+            signal_reconnect_requested();
     });
 
     button_connect = std::make_shared<mygui::Button>(10, 10, "Connect");
@@ -127,8 +139,21 @@ MainWindow::MainWindow() :
     button_sel_desel_all_chkbxs = std::make_shared<mygui::Button>(10, 320, "(De)select");
     button_sel_desel_all_chkbxs->OnClick([this] {
         auto enabled = chart->ToggleDrawAllChartSignals();
-        for (auto& cb : checkboxes_signal_enabled)
-            cb->Checked(enabled);
+        signal_list->SetAllChecked(enabled);
+    });
+
+    auto const& lowest_button = button_sel_desel_all_chkbxs->GetGlobalBounds();
+    const int   list_y        = 15 + lowest_button.top + lowest_button.height;
+    signal_list               = std::make_shared<SignalList>(10, list_y, 85, m_window->getSize().y - list_y - 10);
+    signal_list->OnToggle([this](int idx, bool checked) {
+        chart->SetDrawChartSignal(idx, checked);
+    });
+    signal_list->InfoProvider([this](int idx) -> std::string {
+        auto const& signals = chart->ChartSignals();
+        if (idx >= signals.size())
+            return "";
+        auto kb = signals[idx]->ResidentBytes() / 1024;
+        return kb < 10 * 1024 ? std::to_string(kb) + "k" : std::to_string(kb / 1024) + "M";
     });
 
     action_update_titlebar = std::make_shared<mygui::Action>();
@@ -136,18 +161,20 @@ MainWindow::MainWindow() :
 
     // Add widgets
 
-    Add(chart);
+    Add(chart, sf::FloatRect(100, 10, 1120, 640));
 
-    Add(button_connect);
-    Add(button_run);
-    Add(button_save);
+    Add(button_connect, button_connect->GetGlobalBounds());
+    Add(button_run, button_run->GetGlobalBounds());
+    Add(button_save, button_save->GetGlobalBounds());
 
     Add(textbox_load);
-    Add(button_load);
+    Add(button_load, button_load->GetGlobalBounds());
+
+    Add(button_clear, button_clear->GetGlobalBounds());
 
-    Add(button_clear);
+    Add(button_sel_desel_all_chkbxs, button_sel_desel_all_chkbxs->GetGlobalBounds());
 
-    Add(button_sel_desel_all_chkbxs);
+    Add(signal_list, signal_list->GetGlobalBounds());
 
     Add(action_update_titlebar);
 }
@@ -0,0 +1,118 @@
+#include "MetricsExporter.hpp"
+#include "Profiler.hpp"
+#include "Socket.hpp"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+using namespace Socket;
+using namespace std::chrono_literals;
+
+namespace
+{
+constexpr auto PollTime = 100ms; // the thread wakes up at least this often to check if it should stop
+constexpr auto Timeout  = 1s;    // a client gets this long to send its request and to take the response
+
+// Waits for the socket to become readable (POLLIN) or writable (POLLOUT), false if the deadline passed first
+bool WaitFor(socket_t s, short events, std::chrono::steady_clock::time_point deadline)
+{
+    auto     left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+    pollfd_t fd{s, events, 0};
+    return left > 0 && Poll(&fd, 1, static_cast<int>(left)) > 0;
+}
+} // namespace
+
+MetricsExporter::MetricsExporter(Settings const& settings) :
+    m_settings(settings)
+{
+    if (settings.port) {
+        m_port   = *settings.port;
+        m_listen = static_cast<intptr_t>(ListenLoopback(m_port, "Metrics endpoint"));
+    }
+    m_thread = std::thread(&MetricsExporter::Loop, this);
+}
+
+MetricsExporter::~MetricsExporter()
+{
+    m_stop = true;
+    m_thread.join();
+    if (m_settings.port)
+        CloseSocket(static_cast<socket_t>(m_listen));
+}
+
+void MetricsExporter::Loop()
+{
+    auto next_dump = std::chrono::steady_clock::now();
+    while (!m_stop) {
+        if (!m_settings.file.empty() && std::chrono::steady_clock::now() >= next_dump) {
+            Dump();
+            next_dump = std::chrono::steady_clock::now() + std::chrono::milliseconds(m_settings.interval_ms);
+        }
+
+        if (!m_settings.port) {
+            std::this_thread::sleep_for(PollTime);
+            continue;
+        }
+        if (!WaitFor(static_cast<socket_t>(m_listen), POLLIN, std::chrono::steady_clock::now() + PollTime))
+            continue;
+        auto client = accept(static_cast<socket_t>(m_listen), nullptr, nullptr);
+        if (client != Invalid) {
+            Serve(static_cast<intptr_t>(client));
+            CloseSocket(client);
+        }
+    }
+}
+
+// One request per connection, clients are scrapers that ask every few seconds, so they are served one at a time
+void MetricsExporter::Serve(intptr_t client) const
+{
+    auto s        = static_cast<socket_t>(client);
+    auto deadline = std::chrono::steady_clock::now() + Timeout;
+    NonBlocking(s);
+
+    std::string request;
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+        if (!WaitFor(s, POLLIN, deadline))
+            return;
+        char buf[1024];
+        auto n = recv(s, buf, sizeof(buf), 0);
+        if (n <= 0)
+            return;
+        request.append(buf, n);
+    }
+
+    bool found    = request.rfind("GET /metrics ", 0) == 0 || request.rfind("GET / ", 0) == 0;
+    auto body     = found ? Profiler::Get().Prometheus() : std::string("Metrics are at /metrics\n");
+    auto response = std::string(found ? "HTTP/1.1 200 OK\r\n" : "HTTP/1.1 404 Not Found\r\n") +
+                    "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n" +
+                    "Content-Length: " + std::to_string(body.size()) + "\r\n" +
+                    "Connection: close\r\n\r\n" + body;
+
+    for (size_t sent = 0; sent < response.size();) {
+        auto n = send(s, response.data() + sent, static_cast<int>(response.size() - sent), SendFlags);
+        if (n > 0)
+            sent += n;
+        else if (!WouldBlock() || !WaitFor(s, POLLOUT, deadline))
+            return;
+    }
+}
+
+// Written next to the file and renamed over it, so readers never see half of it
+void MetricsExporter::Dump() const
+{
+    auto tmp = m_settings.file + ".tmp";
+    {
+        std::ofstream ofs(tmp, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+        ofs << Profiler::Get().Prometheus();
+        if (!ofs) {
+            std::cerr << "Error: can't write metrics to " << tmp << "\n";
+            return;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp, m_settings.file, ec);
+    if (ec)
+        std::cerr << "Error: can't replace " << m_settings.file << " (" << ec.message() << ")\n";
+}
@@ -0,0 +1,195 @@
+#include "NodeStatistics.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+SlidingWindow::SlidingWindow(uint32_t length_ms) :
+    m_width(std::max<uint32_t>(1, (length_ms + Buckets - 1) / Buckets)), m_buckets(Buckets)
+{
+}
+
+void SlidingWindow::Update(uint32_t time_ms, float val)
+{
+    Advance(time_ms);
+    auto& b = m_buckets[m_newest % Buckets];
+    if (b.count++ == 0)
+        b.min = b.max = val;
+    b.min = std::min(b.min, val);
+    b.max = std::max(b.max, val);
+    b.sum += val;
+}
+
+// Receive times never go back, a sample older than the newest bucket is counted in it
+void SlidingWindow::Advance(uint32_t time_ms)
+{
+    uint64_t newest = time_ms / m_width;
+    for (uint64_t i = std::max(m_newest, newest - std::min<uint64_t>(newest, Buckets)) + 1; i <= newest; ++i)
+        m_buckets[i % Buckets] = {};
+    m_newest = std::max(m_newest, newest);
+}
+
+void SlidingWindow::Clear()
+{
+    std::fill(m_buckets.begin(), m_buckets.end(), Bucket{});
+    m_newest = 0;
+}
+
+size_t SlidingWindow::Count() const
+{
+    size_t count = 0;
+    for (auto const& b : m_buckets)
+        count += b.count;
+    return count;
+}
+
+float SlidingWindow::Min() const
+{
+    float min = std::numeric_limits<float>::max();
+    for (auto const& b : m_buckets)
+        if (b.count)
+            min = std::min(min, b.min);
+    return Count() ? min : 0.f;
+}
+
+float SlidingWindow::Max() const
+{
+    float max = std::numeric_limits<float>::lowest();
+    for (auto const& b : m_buckets)
+        if (b.count)
+            max = std::max(max, b.max);
+    return Count() ? max : 0.f;
+}
+
+double SlidingWindow::Mean() const
+{
+    double sum = 0;
+    for (auto const& b : m_buckets)
+        sum += b.sum;
+    return Count() ? sum / Count() : 0.0;
+}
+
+NodeStatistics::NodeStatistics(NodeStatistics const& other)
+{
+    std::scoped_lock<std::mutex> sl(other.m_mtx);
+    m_configured   = other.m_configured;
+    m_count        = other.m_count;
+    m_position     = other.m_position;
+    m_mean         = other.m_mean;
+    m_m2           = other.m_m2;
+    m_min          = other.m_min;
+    m_max          = other.m_max;
+    m_window_names = other.m_window_names;
+    m_windows      = other.m_windows;
+}
+
+void NodeStatistics::Configure(std::vector<std::pair<std::string, uint32_t>> const& windows)
+{
+    std::scoped_lock<std::mutex> sl(m_mtx);
+    m_window_names.clear();
+    m_windows.clear();
+    for (auto const& [name, length] : windows) {
+        m_window_names.push_back(name);
+        m_windows.emplace_back(length);
+    }
+    m_count = m_position = 0;
+    m_mean = m_m2 = 0;
+    m_min = m_max = 0;
+    m_configured  = true;
+}
+
+bool NodeStatistics::Configured() const
+{
+    std::scoped_lock<std::mutex> sl(m_mtx);
+    return m_configured;
+}
+
+void NodeStatistics::Update(const float* data, TimeColumn::Entry const* times, size_t n)
+{
+    std::scoped_lock<std::mutex> sl(m_mtx);
+    m_position += n;
+    for (size_t i = 0; i < n; ++i) {
+        float val = data[i];
+        if (m_count == 0)
+            m_min = m_max = val;
+        m_min = std::min(m_min, val);
+        m_max = std::max(m_max, val);
+
+        // Welford
+        m_count++;
+        double delta = val - m_mean;
+        m_mean += delta / m_count;
+        m_m2 += delta * (val - m_mean);
+
+        for (auto& w : m_windows)
+            w.Update(times[i].time_ms, val);
+    }
+}
+
+void NodeStatistics::Skip(size_t n, uint32_t time_ms)
+{
+    std::scoped_lock<std::mutex> sl(m_mtx);
+    m_position += n;
+    for (auto& w : m_windows)
+        w.Advance(time_ms);
+}
+
+void NodeStatistics::Clear()
+{
+    std::scoped_lock<std::mutex> sl(m_mtx);
+    m_count = m_position = 0;
+    m_mean = m_m2 = 0;
+    m_min = m_max = 0;
+    for (auto& w : m_windows)
+        w.Clear();
+}
+
+uint64_t NodeStatistics::Count() const
+{
+    std::scoped_lock<std::mutex> sl(m_mtx);
+    return m_count;
+}
+
+uint64_t NodeStatistics::Position() const
+{
+    std::scoped_lock<std::mutex> sl(m_mtx);
+    return m_position;
+}
+
+NodeStatistics::Summary NodeStatistics::Get() const
+{
+    std::scoped_lock<std::mutex> sl(m_mtx);
+    Summary                      s;
+    s.count = m_count;
+    s.min   = m_min;
+    s.max   = m_max;
+    s.mean  = m_mean;
+    s.stdev = m_count ? std::sqrt(m_m2 / m_count) : 0.0;
+    for (size_t i = 0; i < m_windows.size(); ++i)
+        s.windows.push_back({m_window_names[i], m_windows[i].Count(), m_windows[i].Min(), m_windows[i].Max(), m_windows[i].Mean()});
+    return s;
+}
+
+uint32_t NodeStatistics::ParseDuration(std::string const& str)
+{
+    size_t idx = 0;
+    double val = std::stod(str, &idx);
+    if (val <= 0)
+        throw std::invalid_argument("Duration must be positive: " + str);
+
+    std::string unit = str.substr(idx);
+    for (auto& c : unit)
+        c = std::tolower(static_cast<unsigned char>(c));
+
+    if (unit == "ms")
+        return static_cast<uint32_t>(val);
+    else if (unit.empty() || unit == "s")
+        return static_cast<uint32_t>(val * 1000);
+    else if (unit == "min")
+        return static_cast<uint32_t>(val * 60 * 1000);
+    else if (unit == "h")
+        return static_cast<uint32_t>(val * 60 * 60 * 1000);
+
+    throw std::invalid_argument("Unknown duration unit: " + str);
+}
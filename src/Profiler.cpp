@@ -0,0 +1,270 @@
+#include "Profiler.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+
+int Msb(uint64_t v)
+{
+    int r = 0;
+    while (v >>= 1)
+        r++;
+    return r;
+}
+
+std::string FormatDuration(uint64_t ns)
+{
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1);
+    if (ns < 1000)
+        ss << ns << " ns";
+    else if (ns < 1000 * 1000)
+        ss << ns / 1e3 << " us";
+    else
+        ss << ns / 1e6 << " ms";
+    return ss.str();
+}
+
+std::string FormatBytes(double bytes)
+{
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1);
+    if (bytes < 1024)
+        ss << bytes << " B";
+    else if (bytes < 1024 * 1024)
+        ss << bytes / 1024 << " kB";
+    else
+        ss << bytes / (1024 * 1024) << " MB";
+    return ss.str();
+}
+
+} // namespace
+
+int Profiler::Histogram::BucketIndex(uint64_t ns)
+{
+    constexpr uint64_t sub_buckets = 1 << SubBits;
+    if (ns < sub_buckets)
+        return static_cast<int>(ns);
+
+    int msb = Msb(ns);
+    int sub = static_cast<int>((ns >> (msb - SubBits)) & (sub_buckets - 1));
+    return (msb - SubBits + 1) * sub_buckets + sub;
+}
+
+// Middle of the bucket
+uint64_t Profiler::Histogram::BucketValue(int idx)
+{
+    constexpr int sub_buckets = 1 << SubBits;
+    if (idx < sub_buckets)
+        return idx;
+
+    int      msb  = idx / sub_buckets - 1 + SubBits;
+    int      sub  = idx % sub_buckets;
+    uint64_t step = 1ull << (msb - SubBits);
+    return (1ull << msb) + sub * step + step / 2;
+}
+
+void Profiler::Histogram::Record(uint64_t ns)
+{
+    m_buckets[BucketIndex(ns)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(ns, std::memory_order_relaxed);
+    // Other threads may raise the max meanwhile, a plain store could lower it again
+    auto max = m_max.load(std::memory_order_relaxed);
+    while (ns > max && !m_max.compare_exchange_weak(max, ns, std::memory_order_relaxed))
+        ;
+}
+
+void Profiler::Histogram::Clear()
+{
+    for (auto& b : m_buckets)
+        b.store(0, std::memory_order_relaxed);
+    m_count.store(0, std::memory_order_relaxed);
+    m_sum.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+void Profiler::Histogram::CopyFrom(Histogram const& other)
+{
+    for (int i = 0; i < NumBuckets; ++i)
+        m_buckets[i].store(other.m_buckets[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    m_count.store(other.Count(), std::memory_order_relaxed);
+    m_sum.store(other.Sum(), std::memory_order_relaxed);
+    m_max.store(other.Max(), std::memory_order_relaxed);
+}
+
+uint64_t Profiler::Histogram::Percentile(double p) const
+{
+    uint64_t count = Count();
+    if (count == 0)
+        return 0;
+
+    uint64_t target = static_cast<uint64_t>(p * count + 0.5);
+    if (target < 1)
+        target = 1;
+
+    uint64_t cumulative = 0;
+    for (int i = 0; i < NumBuckets; ++i) {
+        cumulative += m_buckets[i].load(std::memory_order_relaxed);
+        if (cumulative >= target)
+            return std::min(BucketValue(i), Max());
+    }
+
+    return Max();
+}
+
+uint64_t Profiler::Histogram::CountBelow(uint64_t ns) const
+{
+    uint64_t count = 0;
+    for (int i = 0; i < BucketIndex(ns); ++i)
+        count += m_buckets[i].load(std::memory_order_relaxed);
+    return count;
+}
+
+Profiler& Profiler::Get()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+Profiler::Profiler() :
+    m_window_start(std::chrono::steady_clock::now())
+{
+}
+
+void Profiler::Tick()
+{
+    auto now     = std::chrono::steady_clock::now();
+    auto elapsed = now - m_window_start;
+    if (elapsed < 1s)
+        return;
+
+    for (int i = 0; i < NumStages; ++i) {
+        m_last[i].CopyFrom(m_current[i]);
+        m_current[i].Clear();
+    }
+
+    double elapsed_s = std::chrono::duration<double>(elapsed).count();
+    for (int i = 0; i < NumCounters; ++i) {
+        auto total                    = m_counters[i].load(std::memory_order_relaxed);
+        m_rates[i]                    = (total - m_counters_at_window_start[i]) / elapsed_s;
+        m_counters_at_window_start[i] = total;
+    }
+
+    m_window_start = now;
+}
+
+Profiler::StageSummary Profiler::Summary(Stage stage) const
+{
+    auto const&  h = m_last[static_cast<int>(stage)];
+    StageSummary s;
+    s.p50_ns = h.Percentile(0.5);
+    s.p99_ns = h.Percentile(0.99);
+    s.max_ns = h.Max();
+    s.count  = h.Count();
+    return s;
+}
+
+double Profiler::Rate(Counter counter) const
+{
+    return m_rates[static_cast<int>(counter)];
+}
+
+std::string Profiler::Report() const
+{
+    std::stringstream ss;
+    ss << std::left << std::setw(16) << "stage" << std::setw(11) << "p50" << std::setw(11) << "p99" << std::setw(11) << "max"
+       << "n/s\n";
+    for (int i = 0; i < NumStages; ++i) {
+        auto s = Summary(static_cast<Stage>(i));
+        ss << std::setw(16) << Name(static_cast<Stage>(i)) << std::setw(11) << FormatDuration(s.p50_ns) << std::setw(11)
+           << FormatDuration(s.p99_ns) << std::setw(11) << FormatDuration(s.max_ns) << s.count << "\n";
+    }
+    ss << std::fixed << std::setprecision(0) << "packets/s: " << Rate(Counter::Packets) << "   bytes/s: " << FormatBytes(Rate(Counter::Bytes))
+       << "   missed packets: " << Total(Counter::MissedPackets) << "   ingest allocs/s: " << Rate(Counter::IngestAllocations) << "\n";
+    ss << "buffer: " << FormatBytes(static_cast<double>(Value(Gauge::BufferBytes))) << " resident / "
+       << (Value(Gauge::BufferBudgetBytes) ? FormatBytes(static_cast<double>(Value(Gauge::BufferBudgetBytes))) : "unlimited")
+       << "   spilled: " << FormatBytes(static_cast<double>(Value(Gauge::SpilledBytes)));
+    return ss.str();
+}
+
+// Counters and gauges are totals, histograms are cumulative since the start with buckets at powers of two from 1 us
+// to about a minute. Scrapers get rates from the counters, so throughput drops can be alerted on.
+std::string Profiler::Prometheus() const
+{
+    constexpr char const* Prefix = "sample_and_graph_";
+
+    struct Metric {
+        char const* name;
+        char const* help;
+    };
+    constexpr std::array<Metric, NumCounters> counters{{
+        {"packets_total", "Data packets received from all devices."},
+        {"received_bytes_total", "Bytes read from the serial ports."},
+        {"missed_packets_total", "Packets lost between received ones, stored as gaps."},
+        {"ingest_allocations_total", "Heap allocations while parsing packets, excluding sample storage growth."},
+        {"device_failures_total", "Devices dropped because reading them failed."},
+    }};
+    constexpr std::array<Metric, NumGauges> gauges{{
+        {"buffer_bytes", "Sample history resident in memory."},
+        {"buffer_budget_bytes", "Memory budget of the sample history, 0 if unlimited."},
+        {"spilled_bytes", "Sample history spilled to the temporary file."},
+        {"connected_devices", "Devices that are connected."},
+    }};
+
+    std::stringstream ss;
+    for (int i = 0; i < NumCounters; ++i) {
+        ss << "# HELP " << Prefix << counters[i].name << " " << counters[i].help << "\n";
+        ss << "# TYPE " << Prefix << counters[i].name << " counter\n";
+        ss << Prefix << counters[i].name << " " << Total(static_cast<Counter>(i)) << "\n";
+    }
+    for (int i = 0; i < NumGauges; ++i) {
+        ss << "# HELP " << Prefix << gauges[i].name << " " << gauges[i].help << "\n";
+        ss << "# TYPE " << Prefix << gauges[i].name << " gauge\n";
+        ss << Prefix << gauges[i].name << " " << Value(static_cast<Gauge>(i)) << "\n";
+    }
+
+    ss << "# HELP " << Prefix << "stage_duration_seconds Duration of the hot path stages (draw is one frame, save one capture).\n";
+    ss << "# TYPE " << Prefix << "stage_duration_seconds histogram\n";
+    for (int i = 0; i < NumStages; ++i) {
+        std::string stage = Name(static_cast<Stage>(i));
+        std::replace(stage.begin(), stage.end(), ' ', '_');
+        auto const& h      = m_total[i];
+        auto        labels = std::string(Prefix) + "stage_duration_seconds_bucket{stage=\"" + stage + "\",le=\"";
+        uint64_t    below  = 0;
+        for (int bit = 10; bit <= 36; ++bit) {
+            below = h.CountBelow(1ull << bit);
+            ss << labels << (1ull << bit) / 1e9 << "\"} " << below << "\n";
+        }
+        // Buckets are read while stages keep recording, the count must not be below them
+        auto count = std::max(h.Count(), below);
+        ss << labels << "+Inf\"} " << count << "\n";
+        ss << Prefix << "stage_duration_seconds_sum{stage=\"" << stage << "\"} " << h.Sum() / 1e9 << "\n";
+        ss << Prefix << "stage_duration_seconds_count{stage=\"" << stage << "\"} " << count << "\n";
+    }
+    return ss.str();
+}
+
+const char* Profiler::Name(Stage stage)
+{
+    switch (stage) {
+    case Stage::SerialRead:
+        return "serial read";
+    case Stage::PacketExtract:
+        return "packet extract";
+    case Stage::Conversion:
+        return "conversion";
+    case Stage::CurveRebuild:
+        return "curve rebuild";
+    case Stage::Draw:
+        return "draw";
+    case Stage::Save:
+        return "save";
+    default:
+        return "unknown";
+    }
+}
@@ -0,0 +1,154 @@
+#include "RenderBenchmark.hpp"
+#include "Chart.hpp"
+#include <SFML/OpenGL.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <limits>
+#include <random>
+
+namespace
+{
+// Slow sine per node with some noise, in the range of raw NTC readings
+uint32_t SyntheticSample(int node, int idx, std::mt19937& rng)
+{
+    return 2000 + static_cast<uint32_t>(500 * std::sin(idx * 0.001 + node) + rng() % 50);
+}
+} // namespace
+
+std::optional<RenderBenchmarkOptions> RenderBenchmark::ParseArguments(int argc, char* argv[])
+{
+    std::vector<std::string> args(argv + 1, argv + argc);
+    if (std::find(args.begin(), args.end(), "--render-bench") == args.end())
+        return std::nullopt;
+
+    RenderBenchmarkOptions opts;
+    for (size_t i = 0; i < args.size(); ++i) {
+        auto const& arg   = args[i];
+        auto        value = [&] {
+            if (i + 1 >= args.size())
+                throw std::invalid_argument("Missing value for argument '" + arg + "'");
+            return std::stoi(args[++i]);
+        };
+
+        if (arg == "--render-bench")
+            continue;
+        else if (arg == "--nodes")
+            opts.nodes = value();
+        else if (arg == "--samples")
+            opts.samples = value();
+        else if (arg == "--period")
+            opts.period_ms = value();
+        else if (arg == "--width")
+            opts.width = value();
+        else if (arg == "--height")
+            opts.height = value();
+        else if (arg == "--frames")
+            opts.frames = value();
+        else if (arg == "--append")
+            opts.append = value();
+        else if (arg == "--scroll")
+            opts.scroll = value();
+        else
+            throw std::invalid_argument("Unknown argument '" + arg + "'");
+    }
+
+    if (opts.nodes <= 0 || opts.samples <= 0 || opts.period_ms <= 0 || opts.frames <= 0)
+        throw std::invalid_argument("Nodes, samples, period and frames must be positive");
+
+    return opts;
+}
+
+std::string RenderBenchmark::Usage()
+{
+    return "Usage: sample_and_graph --render-bench [--nodes n] [--samples n] [--period ms] [--width px] [--height px]\n"
+           "                        [--frames n] [--append n] [--scroll px]\n";
+}
+
+int RenderBenchmark::Run()
+{
+    sf::RenderTexture texture;
+    if (!texture.create(m_options.width, m_options.height)) {
+        std::cerr << "Error: can't create render texture!\n";
+        return 1;
+    }
+
+    std::mt19937  rng(1);
+    VirtualDevice device;
+    device.SetID(1);
+    device.SetName("synthetic");
+    device.SetSamplingPeriod(m_options.period_ms);
+    for (int n = 0; n < m_options.nodes; ++n) {
+        Node node("N" + std::to_string(n));
+        for (int i = 0; i < m_options.samples; ++i)
+            node.push_back(SyntheticSample(n, i, rng));
+        device.push_back(node);
+    }
+
+    ::Chart chart(0, 0, m_options.width, m_options.height, 100, 100);
+    chart.SetSamplingPeriod(m_options.period_ms);
+    chart.LoadDevices({&device});
+
+    std::cout << m_options.nodes << " signals x " << m_options.samples << " samples, " << m_options.width << "x" << m_options.height
+              << ", " << m_options.frames << " frames per phase\n";
+
+    auto frame = [&](auto&& update) {
+        auto start = std::chrono::steady_clock::now();
+        update();
+        texture.clear(sf::Color(235, 235, 235));
+        texture.draw(chart);
+        texture.display();
+        glFinish();
+
+        size_t vertices = 0;
+        for (auto const& cs : chart.ChartSignals())
+            vertices += cs->Vertices();
+        return Frame{std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(), vertices};
+    };
+
+    // History zoomed to four chart widths, scrolled back and forth through it
+    std::vector<Frame> frames;
+    chart.SetTimeWindow(0.f, static_cast<float>(m_options.samples) * m_options.period_ms / (4 * 60.f * 1000.f));
+    const int scrollable = 3 * static_cast<int>(chart.GraphRegion().width);
+    int       pos = 0, dir = 1;
+    for (int f = 0; f < m_options.frames; ++f) {
+        frames.push_back(frame([&] { chart.Scroll(dir * m_options.scroll); }));
+        pos += dir * m_options.scroll;
+        if (pos >= scrollable || pos <= 0)
+            dir = -dir;
+    }
+    Report("scroll", frames);
+
+    // Scrolled to the newest samples the chart follows them, every frame appends to every signal
+    frames.clear();
+    chart.Scroll(std::numeric_limits<int>::max() / 2);
+    int next = m_options.samples;
+    for (int f = 0; f < m_options.frames; ++f) {
+        frames.push_back(frame([&] {
+            auto& nodes = device.GetNodes();
+            for (int n = 0; n < m_options.nodes; ++n)
+                for (int i = 0; i < m_options.append; ++i)
+                    nodes[n].push_back(SyntheticSample(n, next + i, rng));
+            next += m_options.append;
+            chart.Update();
+        }));
+    }
+    Report("live", frames);
+
+    return 0;
+}
+
+void RenderBenchmark::Report(std::string const& phase, std::vector<Frame> frames)
+{
+    size_t vertices = 0;
+    for (auto const& f : frames)
+        vertices += f.vertices;
+
+    std::sort(frames.begin(), frames.end(), [](Frame const& a, Frame const& b) { return a.ms < b.ms; });
+    auto percentile = [&](double p) { return frames[std::min(frames.size() - 1, static_cast<size_t>(p * frames.size()))].ms; };
+
+    std::printf("%-8s p50 %8.2f ms  p90 %8.2f ms  p99 %8.2f ms  max %8.2f ms  %10zu vertices/frame\n", phase.c_str(), percentile(0.5),
+                percentile(0.9), percentile(0.99), frames.back().ms, vertices / frames.size());
+}
@@ -0,0 +1,214 @@
+#include "Retention.hpp"
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+Retention& Retention::Get()
+{
+    static Retention retention;
+    return retention;
+}
+
+Retention::~Retention()
+{
+    if (m_spill_file.is_open()) {
+        m_spill_file.close();
+        std::remove(m_spill_fname.c_str());
+    }
+}
+
+void Retention::SetBudget(size_t bytes)
+{
+    std::unique_lock<std::recursive_mutex> lock(m_mtx);
+    bool                                   enabled = m_budget == 0 && bytes > 0;
+
+    m_budget  = bytes;
+    m_stalled = false;
+    if (bytes == 0)
+        m_lru.clear();
+
+    // Blocks that became resident without a budget aren't in the LRU list. Stores are never waited for with the lock
+    // held (see Enforce), busy ones are retried after letting their owner go on.
+    std::vector<Spillable*> pending;
+    if (enabled)
+        pending.assign(m_stores.begin(), m_stores.end());
+    while (!pending.empty()) {
+        for (auto it = pending.begin(); it != pending.end();) {
+            if (m_stores.count(*it) > 0) {
+                std::unique_lock<std::mutex> store_lock((*it)->Mutex(), std::try_to_lock);
+                if (!store_lock.owns_lock()) {
+                    ++it;
+                    continue;
+                }
+                (*it)->Retouch();
+            }
+            it = pending.erase(it);
+        }
+        if (!pending.empty()) {
+            lock.unlock();
+            std::this_thread::yield();
+            lock.lock();
+        }
+    }
+    lock.unlock();
+
+    Enforce();
+}
+
+size_t Retention::Budget() const
+{
+    std::scoped_lock<std::recursive_mutex> sl(m_mtx);
+    return m_budget;
+}
+
+size_t Retention::ResidentBytes() const
+{
+    std::scoped_lock<std::recursive_mutex> sl(m_mtx);
+    return m_resident;
+}
+
+size_t Retention::SpilledBytes() const
+{
+    std::scoped_lock<std::recursive_mutex> sl(m_mtx);
+    return m_spilled;
+}
+
+size_t Retention::ParseSize(std::string const& str)
+{
+    size_t idx = 0;
+    double val = std::stod(str, &idx);
+    if (val < 0)
+        throw std::invalid_argument("Negative size: " + str);
+
+    std::string unit = str.substr(idx);
+    for (auto& c : unit)
+        c = std::tolower(static_cast<unsigned char>(c));
+
+    if (unit == "b")
+        return static_cast<size_t>(val);
+    else if (unit == "kb")
+        return static_cast<size_t>(val * 1024);
+    else if (unit.empty() || unit == "mb")
+        return static_cast<size_t>(val * 1024 * 1024);
+    else if (unit == "gb")
+        return static_cast<size_t>(val * 1024 * 1024 * 1024);
+
+    throw std::invalid_argument("Unknown size unit: " + str);
+}
+
+void Retention::Register(Spillable* store)
+{
+    std::scoped_lock<std::recursive_mutex> sl(m_mtx);
+    m_stores.insert(store);
+}
+
+void Retention::Unregister(Spillable* store)
+{
+    std::scoped_lock<std::recursive_mutex> sl(m_mtx);
+    m_stores.erase(store);
+    // Entries of unregistered stores are dropped lazily in Enforce
+}
+
+uint64_t Retention::Touch(Spillable* store, size_t block, size_t bytes)
+{
+    std::scoped_lock<std::recursive_mutex> sl(m_mtx);
+    auto                                   stamp = ++m_next_stamp;
+    m_resident += bytes;
+    // Without a budget nothing is spilled, so there is no need to know the order
+    if (m_budget > 0) {
+        m_lru.push_back({store, block, stamp});
+        m_stalled = false;
+    }
+    return stamp;
+}
+
+void Retention::Released(size_t bytes)
+{
+    std::scoped_lock<std::recursive_mutex> sl(m_mtx);
+    m_resident -= bytes;
+}
+
+uint64_t Retention::Write(const void* data, size_t bytes)
+{
+    std::scoped_lock<std::recursive_mutex> sl(m_mtx);
+
+    if (!m_spill_file.is_open()) {
+        auto now      = std::chrono::steady_clock::now().time_since_epoch().count();
+        m_spill_fname = (std::filesystem::temp_directory_path() / ("sample_and_graph_" + std::to_string(now) + ".spill")).string();
+        m_spill_file.open(m_spill_fname, std::fstream::in | std::fstream::out | std::fstream::binary | std::fstream::trunc);
+        if (!m_spill_file.is_open())
+            throw std::runtime_error("Can't open spill file " + m_spill_fname);
+        std::cout << "Spilling old samples to " << m_spill_fname << "\n";
+    }
+
+    uint64_t offset;
+    if (auto& slots = m_free_slots[bytes]; !slots.empty()) {
+        offset = slots.back();
+        slots.pop_back();
+    } else {
+        offset = m_spill_end;
+        m_spill_end += bytes;
+    }
+
+    m_spill_file.seekp(offset);
+    m_spill_file.write(static_cast<const char*>(data), bytes);
+    if (!m_spill_file)
+        throw std::runtime_error("Writing to spill file " + m_spill_fname + " failed");
+
+    m_spilled += bytes;
+    return offset;
+}
+
+void Retention::Read(uint64_t offset, void* data, size_t bytes)
+{
+    std::scoped_lock<std::recursive_mutex> sl(m_mtx);
+
+    m_spill_file.seekg(offset);
+    m_spill_file.read(static_cast<char*>(data), bytes);
+    if (!m_spill_file)
+        throw std::runtime_error("Reading from spill file " + m_spill_fname + " failed");
+}
+
+void Retention::Free(uint64_t offset, size_t bytes)
+{
+    std::scoped_lock<std::recursive_mutex> sl(m_mtx);
+    m_free_slots[bytes].push_back(offset);
+    m_spilled -= bytes;
+}
+
+void Retention::Enforce()
+{
+    std::scoped_lock<std::recursive_mutex> sl(m_mtx);
+
+    if (m_budget == 0 || m_stalled)
+        return;
+
+    // Every entry is looked at no more than once, entries that can't be spilled right now go to the back
+    for (size_t n = m_lru.size(); m_resident > m_budget && n > 0 && !m_lru.empty(); --n) {
+        auto entry = m_lru.front();
+        m_lru.pop_front();
+
+        if (m_stores.count(entry.store) == 0)
+            continue;
+
+        // Never wait for a store, its owner might be waiting for us
+        std::unique_lock<std::mutex> store_lock(entry.store->Mutex(), std::try_to_lock);
+        if (!store_lock.owns_lock()) {
+            m_lru.push_back(entry);
+            continue;
+        }
+
+        auto released = entry.store->Spill(entry.block, entry.stamp);
+        if (!released)
+            m_lru.push_back(entry);
+        else
+            m_resident -= *released;
+    }
+
+    // A whole pass didn't get below the budget, the blocks left can't be spilled until new ones are touched
+    m_stalled = m_resident > m_budget;
+}
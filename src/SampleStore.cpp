@@ -0,0 +1,224 @@
+#include "SampleStore.hpp"
+#include <cctype>
+#include <stdexcept>
+
+SampleWidth ParseSampleWidth(std::string const& str)
+{
+    std::string s = str;
+    for (auto& c : s)
+        c = std::tolower(static_cast<unsigned char>(c));
+
+    if (s == "u16")
+        return SampleWidth::U16;
+    else if (s == "u32")
+        return SampleWidth::U32;
+    else if (s == "f32")
+        return SampleWidth::F32;
+    else if (s == "auto")
+        return SampleWidth::Auto;
+
+    throw std::invalid_argument("Unknown sample width: " + str);
+}
+
+std::string SampleWidthName(SampleWidth width)
+{
+    switch (width) {
+    case SampleWidth::U16:
+        return "u16";
+    case SampleWidth::U32:
+        return "u32";
+    case SampleWidth::F32:
+        return "f32";
+    default:
+        return "auto";
+    }
+}
+
+GapIndex::GapIndex(GapIndex const& other)
+{
+    std::scoped_lock<std::mutex> sl(other.m_mtx);
+    m_runs  = other.m_runs;
+    m_total = other.m_total;
+}
+
+// Adjacent runs are merged
+void GapIndex::Add(size_t begin, size_t n)
+{
+    if (n == 0)
+        return;
+
+    std::scoped_lock<std::mutex> sl(m_mtx);
+    if (!m_runs.empty() && m_runs.back().run.begin + m_runs.back().run.length == begin)
+        m_runs.back().run.length += n;
+    else
+        m_runs.push_back({{begin, n}, m_total});
+    m_total += n;
+}
+
+size_t GapIndex::Total() const
+{
+    std::scoped_lock<std::mutex> sl(m_mtx);
+    return m_total;
+}
+
+std::vector<GapIndex::Run> GapIndex::Runs() const
+{
+    std::scoped_lock<std::mutex> sl(m_mtx);
+    std::vector<Run>             runs;
+    runs.reserve(m_runs.size());
+    for (auto const& e : m_runs)
+        runs.push_back(e.run);
+    return runs;
+}
+
+void GapIndex::clear()
+{
+    std::scoped_lock<std::mutex> sl(m_mtx);
+    m_runs.clear();
+    m_total = 0;
+}
+
+size_t GapIndex::ResidentBytes() const
+{
+    std::scoped_lock<std::mutex> sl(m_mtx);
+    return m_runs.capacity() * sizeof(Entry);
+}
+
+std::unique_ptr<SampleStore> SampleStore::Create(SampleWidth width)
+{
+    switch (width) {
+    case SampleWidth::U16:
+        return std::make_unique<TypedSampleStore<uint16_t>>();
+    case SampleWidth::U32:
+        return std::make_unique<TypedSampleStore<uint32_t>>();
+    case SampleWidth::F32:
+        return std::make_unique<TypedSampleStore<float>>();
+    default:
+        return std::make_unique<AutoSampleStore>();
+    }
+}
+
+// Samples between the gaps are copied, gaps are added as runs again
+void SampleStore::Copy(SampleStore const& from, SampleStore& to)
+{
+    auto copy = [&](auto tag) {
+        std::vector<decltype(tag)> chunk(BlockSize);
+        size_t                     pos  = 0;
+        auto                       upto = [&](size_t end) {
+            for (size_t n; pos < end && (n = from.Read(pos, std::min(chunk.size(), end - pos), chunk.data())) > 0; pos += n)
+                to.append(chunk.data(), n);
+        };
+        for (auto const& gap : from.Gaps()) {
+            upto(gap.begin);
+            to.append_gap(gap.length);
+            pos += gap.length;
+        }
+        upto(from.size());
+    };
+
+    if (from.Width() == SampleWidth::F32)
+        copy(float{});
+    else
+        copy(uint32_t{});
+}
+
+AutoSampleStore::AutoSampleStore() :
+    m_store(Create(SampleWidth::U16))
+{
+}
+
+AutoSampleStore::AutoSampleStore(AutoSampleStore const& other)
+{
+    std::scoped_lock<std::mutex> sl(other.m_mtx);
+    m_store = other.m_store->Clone();
+}
+
+SampleWidth AutoSampleStore::Width() const
+{
+    std::scoped_lock<std::mutex> sl(m_mtx);
+    return m_store->Width();
+}
+
+size_t AutoSampleStore::size() const
+{
+    std::scoped_lock<std::mutex> sl(m_mtx);
+    return m_store->size();
+}
+
+void AutoSampleStore::append(const uint32_t* data, size_t n)
+{
+    std::scoped_lock<std::mutex> sl(m_mtx);
+    if (m_store->Width() == SampleWidth::U16) {
+        // Missing samples are stored as gaps, they don't need the wider store
+        uint32_t max = 0;
+        for (size_t i = 0; i < n; ++i)
+            max = data[i] > max && data[i] != Missing ? data[i] : max;
+        if (max > std::numeric_limits<uint16_t>::max())
+            Widen(SampleWidth::U32);
+    }
+    m_store->append(data, n);
+}
+
+// Samples that come as floats are kept as floats
+void AutoSampleStore::append(const float* data, size_t n)
+{
+    std::scoped_lock<std::mutex> sl(m_mtx);
+    if (m_store->Width() != SampleWidth::F32)
+        Widen(SampleWidth::F32);
+    m_store->append(data, n);
+}
+
+size_t AutoSampleStore::Read(size_t begin, size_t n, uint32_t* out) const
+{
+    std::scoped_lock<std::mutex> sl(m_mtx);
+    return m_store->Read(begin, n, out);
+}
+
+size_t AutoSampleStore::Read(size_t begin, size_t n, float* out) const
+{
+    std::scoped_lock<std::mutex> sl(m_mtx);
+    return m_store->Read(begin, n, out);
+}
+
+// Store goes back to the narrowest width
+void AutoSampleStore::clear()
+{
+    std::scoped_lock<std::mutex> sl(m_mtx);
+    if (m_store->Width() != SampleWidth::U16)
+        m_store = Create(SampleWidth::U16);
+    else
+        m_store->clear();
+}
+
+size_t AutoSampleStore::ResidentBytes() const
+{
+    std::scoped_lock<std::mutex> sl(m_mtx);
+    return m_store->ResidentBytes();
+}
+
+std::unique_ptr<SampleStore> AutoSampleStore::Clone() const
+{
+    return std::make_unique<AutoSampleStore>(*this);
+}
+
+void AutoSampleStore::append_gap(size_t n)
+{
+    std::scoped_lock<std::mutex> sl(m_mtx);
+    m_store->append_gap(n);
+}
+
+std::vector<GapIndex::Run> AutoSampleStore::Gaps() const
+{
+    std::scoped_lock<std::mutex> sl(m_mtx);
+    return m_store->Gaps();
+}
+
+// Called with m_mtx held
+void AutoSampleStore::Widen(SampleWidth width)
+{
+    std::cout << "Widening sample storage from " << SampleWidthName(m_store->Width()) << " to " << SampleWidthName(width) << "\n";
+
+    auto wider = Create(width);
+    Copy(*m_store, *wider);
+    m_store = std::move(wider);
+}
@@ -0,0 +1,254 @@
+#include "SharedRing.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace SharedRing
+{
+namespace
+{
+constexpr size_t Align(size_t n) { return (n + 63) / 64 * 64; } // cache lines, devices don't share them
+
+constexpr size_t DevicesOffset = Align(sizeof(Header));
+
+// POSIX shared memory names start with a '/'
+std::string ShmName(std::string const& name)
+{
+    return !name.empty() && name[0] == '/' ? name : "/" + name;
+}
+
+std::string Error(std::string const& what, std::string const& name)
+{
+    return "Shared ring: " + what + " " + name + " (" + std::strerror(errno) + ")";
+}
+
+// Copies the last samples of src (n of them, as many as fit) into the ring column, starting at sequence number seq
+template <typename T>
+void CopyToRing(T* column, uint64_t capacity, uint64_t seq, T const* src, size_t n)
+{
+    for (size_t i = n > capacity ? n - capacity : 0; i < n;) {
+        size_t slot = static_cast<size_t>((seq + i) % capacity);
+        size_t len  = std::min<size_t>(n - i, capacity - slot);
+        std::memcpy(column + slot, src + i, len * sizeof(T));
+        i += len;
+    }
+}
+} // namespace
+
+Writer::Writer(std::string const& name, std::vector<Device> const& devices) :
+    m_name(ShmName(name)), m_devices(devices)
+{
+#ifdef _WIN32
+    throw std::runtime_error("Shared ring: POSIX shared memory isn't available on this platform");
+#else
+    struct Offsets {
+        uint64_t names, times, values;
+    };
+    std::vector<Offsets> offsets;
+    size_t               size = DevicesOffset + devices.size() * sizeof(DeviceHeader);
+    for (auto const& d : devices) {
+        size_t names = d.name.size() + 1;
+        for (auto const& n : d.nodes)
+            names += n.size() + 1;
+
+        Offsets o;
+        o.names  = size;
+        o.times  = (size += Align(names));
+        o.values = (size += Align(d.capacity * sizeof(Time)));
+        size += Align(d.capacity * d.nodes.size() * sizeof(float));
+        offsets.push_back(o);
+    }
+
+    shm_unlink(m_name.c_str()); // left behind by a writer that crashed
+    int fd = shm_open(m_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0)
+        throw std::runtime_error(Error("can't create", m_name));
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        auto error = Error("can't size", m_name);
+        close(fd);
+        shm_unlink(m_name.c_str());
+        throw std::runtime_error(error);
+    }
+    void* mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) {
+        auto error = Error("can't map", m_name);
+        shm_unlink(m_name.c_str());
+        throw std::runtime_error(error);
+    }
+    m_base = static_cast<uint8_t*>(mem);
+    m_size = size;
+
+    // The memory is zeroed, nothing is published yet
+    auto* header    = new (m_base) Header{};
+    header->version = Version;
+    header->size    = size;
+    header->devices = static_cast<uint32_t>(devices.size());
+    for (size_t i = 0; i < devices.size(); ++i) {
+        auto const& d = devices[i];
+        auto*       h = new (m_base + DevicesOffset + i * sizeof(DeviceHeader)) DeviceHeader{};
+        h->id         = d.id;
+        h->period_ms  = d.period_ms;
+        h->nodes      = static_cast<uint32_t>(d.nodes.size());
+        h->capacity   = d.capacity;
+        h->names      = offsets[i].names;
+        h->times      = offsets[i].times;
+        h->values     = offsets[i].values;
+
+        auto* names = reinterpret_cast<char*>(m_base + h->names);
+        std::memcpy(names, d.name.c_str(), d.name.size() + 1);
+        names += d.name.size() + 1;
+        for (auto const& n : d.nodes) {
+            std::memcpy(names, n.c_str(), n.size() + 1);
+            names += n.size() + 1;
+        }
+    }
+    header->magic.store(Magic, std::memory_order_release);
+#endif
+}
+
+Writer::~Writer()
+{
+#ifndef _WIN32
+    reinterpret_cast<Header*>(m_base)->closed.store(1, std::memory_order_release);
+    munmap(m_base, m_size);
+    shm_unlink(m_name.c_str());
+#endif
+}
+
+// Seqlock writer: the samples that get overwritten are invalidated (writing) before they are, the new ones are
+// published after they are written. The release fence keeps the data stores from moving before the announcement.
+void Writer::Write(size_t device, size_t n, Time const* times, float const* values)
+{
+    auto&    h   = *reinterpret_cast<DeviceHeader*>(m_base + DevicesOffset + device * sizeof(DeviceHeader));
+    uint64_t seq = h.published.load(std::memory_order_relaxed);
+    if (n == 0 || h.capacity == 0)
+        return;
+
+    h.writing.store(seq + n, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    CopyToRing(reinterpret_cast<Time*>(m_base + h.times), h.capacity, seq, times, n);
+    auto* columns = reinterpret_cast<float*>(m_base + h.values);
+    for (size_t node = 0; node < h.nodes; ++node)
+        CopyToRing(columns + node * h.capacity, h.capacity, seq, values + node * n, n);
+
+    h.published.store(seq + n, std::memory_order_release);
+}
+
+Reader::Reader(std::string const& name)
+{
+#ifdef _WIN32
+    throw std::runtime_error("Shared ring: POSIX shared memory isn't available on this platform");
+#else
+    auto shm_name = ShmName(name);
+    int  fd       = shm_open(shm_name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+        throw std::runtime_error(Error("can't open", shm_name));
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < DevicesOffset) {
+        close(fd);
+        throw std::runtime_error("Shared ring: " + shm_name + " isn't initialized yet");
+    }
+    void* mem = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED)
+        throw std::runtime_error(Error("can't map", shm_name));
+    m_base = static_cast<uint8_t const*>(mem);
+    m_size = st.st_size;
+
+    auto const& header = *reinterpret_cast<Header const*>(m_base);
+    if (header.magic.load(std::memory_order_acquire) != Magic || header.version != Version || header.size > m_size ||
+        DevicesOffset + header.devices * sizeof(DeviceHeader) > header.size) {
+        munmap(mem, m_size);
+        throw std::runtime_error("Shared ring: " + shm_name + " isn't initialized yet or has another version");
+    }
+
+    for (size_t i = 0; i < header.devices; ++i) {
+        auto const& h     = At(i);
+        auto        names = reinterpret_cast<char const*>(m_base + h.names);
+        Device      d{h.id, h.period_ms, names, {}, h.capacity};
+        names += d.name.size() + 1;
+        for (uint32_t n = 0; n < h.nodes; ++n) {
+            d.nodes.emplace_back(names);
+            names += d.nodes.back().size() + 1;
+        }
+        m_devices.push_back(std::move(d));
+    }
+#endif
+}
+
+Reader::~Reader()
+{
+#ifndef _WIN32
+    munmap(const_cast<uint8_t*>(m_base), m_size);
+#endif
+}
+
+bool Reader::Closed() const
+{
+    return reinterpret_cast<Header const*>(m_base)->closed.load(std::memory_order_acquire) != 0;
+}
+
+DeviceHeader const& Reader::At(size_t device) const
+{
+    return *reinterpret_cast<DeviceHeader const*>(m_base + DevicesOffset + device * sizeof(DeviceHeader));
+}
+
+Reader::Window Reader::Last(size_t device, double seconds) const
+{
+    auto     want = static_cast<uint64_t>(std::ceil(seconds * 1000 / std::max(1u, At(device).period_ms)));
+    uint64_t end  = At(device).published.load(std::memory_order_acquire);
+    return Since(device, end > want ? end - want : 0);
+}
+
+// Samples the writer is overwriting (below writing - capacity) are left out
+Reader::Window Reader::Since(size_t device, uint64_t begin) const
+{
+    auto const& h       = At(device);
+    uint64_t    end     = h.published.load(std::memory_order_acquire);
+    uint64_t    writing = h.writing.load(std::memory_order_acquire);
+    uint64_t    oldest  = writing > h.capacity ? writing - h.capacity : 0;
+    return {device, std::min(std::max(begin, oldest), end), end};
+}
+
+Span<Time> Reader::Times(Window const& w) const
+{
+    return Column<Time>(w, At(w.device).times);
+}
+
+Span<float> Reader::Values(Window const& w, size_t node) const
+{
+    auto const& h = At(w.device);
+    return Column<float>(w, h.values + node * h.capacity * sizeof(float));
+}
+
+// Seqlock reader: the acquire fence keeps the reads of the window from moving after the check
+bool Reader::Valid(Window const& w) const
+{
+    std::atomic_thread_fence(std::memory_order_acquire);
+    auto const& h = At(w.device);
+    return h.writing.load(std::memory_order_relaxed) <= w.begin + h.capacity;
+}
+
+template <typename T>
+Span<T> Reader::Column(Window const& w, uint64_t offset) const
+{
+    auto const& h      = At(w.device);
+    auto        column = reinterpret_cast<T const*>(m_base + offset);
+    if (h.capacity == 0)
+        return {column, 0, column, 0};
+    size_t slot = static_cast<size_t>(w.begin % h.capacity);
+    return {column + slot, std::min(w.Size(), static_cast<size_t>(h.capacity) - slot), column, w.Size()};
+}
+} // namespace SharedRing
@@ -0,0 +1,203 @@
+#include "SignalList.hpp"
+#include <algorithm>
+#include <cctype>
+#include <mygui/ResourceManager.hpp>
+
+SignalList::SignalList(int x, int y, int w, int h) :
+    m_rect(x, y, w, h), m_background(sf::Vector2f(w, h))
+{
+    m_font.loadFromFile(mygui::ResourceManager::GetSystemFontName());
+
+    m_background.setPosition(x, y);
+    m_background.setFillColor(sf::Color::White);
+    m_background.setOutlineColor(sf::Color::Black);
+    m_background.setOutlineThickness(1.f);
+
+    m_filter_text.setFont(m_font);
+    m_filter_text.setFillColor(sf::Color::Black);
+    m_filter_text.setCharacterSize(13);
+    m_filter_text.setPosition(x + 3.f, y + 2.f);
+
+    m_scrollbar.setFillColor(sf::Color(100, 100, 100, 150));
+
+    // First row is occupied by the filter
+    m_num_visible_rows = std::max(0, h / m_row_height - 1);
+    m_row_boxes.resize(m_num_visible_rows, sf::RectangleShape(sf::Vector2f(m_box_size, m_box_size)));
+    m_row_marks.resize(m_num_visible_rows, sf::RectangleShape(sf::Vector2f(m_box_size - 6, m_box_size - 6)));
+    m_row_texts.resize(m_num_visible_rows);
+    m_row_infos.resize(m_num_visible_rows);
+    for (int i = 0; i < m_num_visible_rows; ++i) {
+        float row_y = y + (i + 1) * m_row_height + (m_row_height - m_box_size) / 2.f;
+        m_row_boxes[i].setPosition(x + 3.f, row_y);
+        m_row_boxes[i].setFillColor(sf::Color::White);
+        m_row_boxes[i].setOutlineColor(sf::Color::Black);
+        m_row_boxes[i].setOutlineThickness(1.f);
+        m_row_marks[i].setPosition(x + 6.f, row_y + 3.f);
+        m_row_marks[i].setFillColor(sf::Color::Black);
+        m_row_texts[i].setFont(m_font);
+        m_row_texts[i].setFillColor(sf::Color::Black);
+        m_row_texts[i].setCharacterSize(13);
+        m_row_texts[i].setPosition(x + 6.f + m_box_size, row_y - 2.f);
+        m_row_infos[i].setFont(m_font);
+        m_row_infos[i].setFillColor(sf::Color(100, 100, 100));
+        m_row_infos[i].setCharacterSize(10);
+    }
+
+    UpdateRows();
+}
+
+void SignalList::draw(sf::RenderTarget& target, sf::RenderStates states) const
+{
+    target.draw(m_background, states);
+    target.draw(m_filter_text, states);
+    for (int i = 0; i < m_num_drawn_rows; ++i) {
+        target.draw(m_row_boxes[i], states);
+        if (m_rows[m_filtered[m_first_visible + i]].checked)
+            target.draw(m_row_marks[i], states);
+        target.draw(m_row_texts[i], states);
+        if (m_info_provider)
+            target.draw(m_row_infos[i], states);
+    }
+    if (m_filtered.size() > static_cast<size_t>(m_num_visible_rows))
+        target.draw(m_scrollbar, states);
+}
+
+void SignalList::Handle(const sf::Event& event)
+{
+    if (!Enabled())
+        return;
+
+    if (event.type == sf::Event::MouseMoved) {
+        m_mouseover = m_rect.contains(sf::Vector2f(event.mouseMove.x, event.mouseMove.y));
+    } else if (event.type == sf::Event::MouseWheelScrolled && m_mouseover) {
+        Scroll(event.mouseWheelScroll.delta > 0 ? -3 : 3);
+    } else if (event.type == sf::Event::MouseButtonPressed && event.mouseButton.button == sf::Mouse::Left &&
+               m_rect.contains(sf::Vector2f(event.mouseButton.x, event.mouseButton.y))) {
+        int row = static_cast<int>((event.mouseButton.y - m_rect.top) / m_row_height) - 1;
+        if (row >= 0 && row < m_num_drawn_rows) {
+            int   idx = m_filtered[m_first_visible + row];
+            auto& r   = m_rows[idx];
+            r.checked = !r.checked;
+            if (m_onToggle)
+                m_onToggle(idx, r.checked);
+        }
+    } else if (event.type == sf::Event::KeyPressed && m_mouseover) {
+        if (event.key.code == sf::Keyboard::PageDown)
+            Scroll(m_num_visible_rows);
+        else if (event.key.code == sf::Keyboard::PageUp)
+            Scroll(-m_num_visible_rows);
+    } else if (event.type == sf::Event::TextEntered && m_mouseover) {
+        auto c = event.text.unicode;
+        if (c == '\b') {
+            if (!m_filter.empty())
+                Filter(m_filter.substr(0, m_filter.size() - 1));
+        } else if (c == 27) { // Esc
+            Filter("");
+        } else if (c >= 32 && c < 127) {
+            Filter(m_filter + static_cast<char>(c));
+        }
+    }
+}
+
+void SignalList::Enabled(bool enabled)
+{
+    m_enabled = enabled;
+}
+
+bool SignalList::Enabled() const
+{
+    return m_enabled;
+}
+
+void SignalList::SetSignals(std::vector<std::string> const& names)
+{
+    m_rows.clear();
+    m_rows.reserve(names.size());
+    for (auto const& n : names)
+        m_rows.push_back({n, true});
+
+    ApplyFilter();
+}
+
+void SignalList::SetAllChecked(bool checked)
+{
+    for (auto& r : m_rows)
+        r.checked = checked;
+}
+
+bool SignalList::Checked(int idx) const
+{
+    return idx >= 0 && static_cast<size_t>(idx) < m_rows.size() && m_rows[idx].checked;
+}
+
+void SignalList::Filter(std::string const& filter)
+{
+    m_filter = filter;
+    ApplyFilter();
+}
+
+void SignalList::Refresh()
+{
+    UpdateRows();
+}
+
+void SignalList::OnToggle(const toggle_callback_type& f)
+{
+    m_onToggle = f;
+}
+
+void SignalList::InfoProvider(const info_provider_type& f)
+{
+    m_info_provider = f;
+    UpdateRows();
+}
+
+// Case insensitive substring match
+void SignalList::ApplyFilter()
+{
+    auto lower = [](std::string str) {
+        std::transform(str.begin(), str.end(), str.begin(), [](unsigned char c) { return std::tolower(c); });
+        return str;
+    };
+
+    auto filter = lower(m_filter);
+    m_filtered.clear();
+    for (size_t i = 0; i < m_rows.size(); ++i)
+        if (filter.empty() || lower(m_rows[i].name).find(filter) != std::string::npos)
+            m_filtered.push_back(i);
+
+    m_first_visible = 0;
+    UpdateRows();
+}
+
+void SignalList::Scroll(int rows)
+{
+    int max_first   = std::max(0, static_cast<int>(m_filtered.size()) - m_num_visible_rows);
+    m_first_visible = std::clamp(m_first_visible + rows, 0, max_first);
+    UpdateRows();
+}
+
+void SignalList::UpdateRows()
+{
+    m_num_drawn_rows = std::min(m_num_visible_rows, static_cast<int>(m_filtered.size()) - m_first_visible);
+    for (int i = 0; i < m_num_drawn_rows; ++i) {
+        int idx = m_filtered[m_first_visible + i];
+        m_row_texts[i].setString(m_rows[idx].name);
+        if (m_info_provider) {
+            auto& info = m_row_infos[i];
+            info.setString(m_info_provider(idx));
+            info.setPosition(m_rect.left + m_rect.width - info.getLocalBounds().width - 8.f, m_row_texts[i].getPosition().y + 3.f);
+        }
+    }
+
+    m_filter_text.setString("filter: " + m_filter + "_  (" + std::to_string(m_filtered.size()) + ")");
+
+    if (m_filtered.size() > static_cast<size_t>(m_num_visible_rows)) {
+        float track_top    = m_rect.top + m_row_height;
+        float track_height = m_rect.height - m_row_height;
+        float thumb_height = std::max(10.f, track_height * m_num_visible_rows / m_filtered.size());
+        float thumb_top    = track_top + (track_height - thumb_height) * m_first_visible / (m_filtered.size() - m_num_visible_rows);
+        m_scrollbar.setSize(sf::Vector2f(4.f, thumb_height));
+        m_scrollbar.setPosition(m_rect.left + m_rect.width - 5.f, thumb_top);
+    }
+}
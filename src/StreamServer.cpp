@@ -0,0 +1,215 @@
+#include "StreamServer.hpp"
+#include "Socket.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using namespace Socket;
+
+namespace
+{
+constexpr int PollMs = 100; // the server thread wakes up at least this often to check if it should stop
+
+uint16_t FrameType(std::vector<uint8_t> const& frame)
+{
+    uint16_t type;
+    std::memcpy(&type, frame.data() + 4, sizeof(type));
+    return type;
+}
+
+template <typename T>
+void Put(std::vector<uint8_t>& out, T val)
+{
+    auto p = reinterpret_cast<uint8_t const*>(&val);
+    out.insert(out.end(), p, p + sizeof(val));
+}
+} // namespace
+
+StreamServer::StreamServer(Settings const& settings) :
+    m_settings(settings), m_port(settings.port)
+{
+    m_settings.queue_frames = std::max<size_t>(m_settings.queue_frames, MinQueueFrames);
+    auto s = ListenLoopback(m_port, "Stream server");
+
+    // Connection to itself that wakes up the server thread when frames are queued, works with poll on every platform
+    auto addr = Loopback(m_port);
+    auto tx   = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (tx == Invalid || connect(tx, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        CloseSocket(s);
+        throw std::runtime_error("Stream server: can't create wake up connection");
+    }
+    auto rx = accept(s, nullptr, nullptr); // the connection is queued once connect returns
+    if (rx == Invalid) {
+        CloseSocket(tx);
+        CloseSocket(s);
+        throw std::runtime_error("Stream server: can't create wake up connection");
+    }
+    NonBlocking(tx);
+    NonBlocking(rx);
+
+    m_listen  = static_cast<intptr_t>(s);
+    m_wake_tx = static_cast<intptr_t>(tx);
+    m_wake_rx = static_cast<intptr_t>(rx);
+    m_thread  = std::thread(&StreamServer::Loop, this);
+}
+
+StreamServer::~StreamServer()
+{
+    m_stop = true;
+    Wake();
+    m_thread.join();
+    for (auto& c : m_clients)
+        CloseSocket(static_cast<socket_t>(c.socket));
+    CloseSocket(static_cast<socket_t>(m_wake_tx));
+    CloseSocket(static_cast<socket_t>(m_wake_rx));
+    CloseSocket(static_cast<socket_t>(m_listen));
+}
+
+std::vector<uint8_t> StreamServer::MakeFrame(uint16_t type, std::vector<uint8_t> const& payload)
+{
+    std::vector<uint8_t> frame;
+    frame.reserve(HeaderSize + payload.size());
+    Put(frame, Magic);
+    Put(frame, type);
+    Put(frame, uint16_t{0}); // reserved
+    Put(frame, static_cast<uint32_t>(payload.size()));
+    frame.insert(frame.end(), payload.begin(), payload.end());
+    return frame;
+}
+
+void StreamServer::SetHello(Frame frame)
+{
+    {
+        std::scoped_lock<std::mutex> sl(m_mtx);
+        m_hello = frame;
+        for (auto& c : m_clients)
+            c.queue.push_back(frame);
+    }
+    Wake();
+}
+
+void StreamServer::Publish(Frame frame)
+{
+    Queue(frame);
+    Wake();
+}
+
+void StreamServer::Queue(Frame const& frame)
+{
+    std::scoped_lock<std::mutex> sl(m_mtx);
+    for (auto& c : m_clients) {
+        if (c.closing)
+            continue;
+        while (!c.closing && c.queue.size() >= m_settings.queue_frames) {
+            // The front frame may be partly sent already, it has to be finished or the stream is corrupted. Devices
+            // frames are kept, the samples frames after them can't be decoded without them.
+            auto drop = std::find_if(c.queue.begin() + (c.sent > 0 ? 1 : 0), c.queue.end(), [](Frame const& f) { return FrameType(*f) != FrameDevices; });
+            if (m_settings.overflow == Overflow::Disconnect || drop == c.queue.end()) {
+                c.closing = true;
+                break;
+            }
+            c.queue.erase(drop);
+            m_dropped++;
+        }
+        if (!c.closing)
+            c.queue.push_back(frame);
+    }
+}
+
+// A full socket buffer means a wake up is pending anyway
+void StreamServer::Wake()
+{
+    char c = 0;
+    send(static_cast<socket_t>(m_wake_tx), &c, 1, SendFlags);
+}
+
+void StreamServer::Loop()
+{
+    constexpr size_t      FirstClient = 2; // in fds, after the listening socket and the wake up connection
+    std::vector<pollfd_t> fds;
+    while (!m_stop) {
+        fds.clear();
+        fds.push_back({static_cast<socket_t>(m_listen), POLLIN, 0});
+        fds.push_back({static_cast<socket_t>(m_wake_rx), POLLIN, 0});
+        {
+            std::scoped_lock<std::mutex> sl(m_mtx);
+            for (auto const& c : m_clients)
+                fds.push_back({static_cast<socket_t>(c.socket), static_cast<short>(POLLIN | (c.queue.empty() ? 0 : POLLOUT)), 0});
+        }
+
+        if (Poll(fds.data(), fds.size(), PollMs) <= 0)
+            continue;
+
+        if (fds[0].revents & POLLIN)
+            Accept();
+        if (fds[1].revents & POLLIN) {
+            char buf[256];
+            while (recv(static_cast<socket_t>(m_wake_rx), buf, sizeof(buf), 0) > 0)
+                ;
+        }
+
+        std::scoped_lock<std::mutex> sl(m_mtx);
+        // Clients accepted meanwhile are at the end and weren't polled
+        for (size_t i = FirstClient; i < fds.size(); ++i) {
+            auto& c    = m_clients[i - FirstClient];
+            bool  gone = c.closing || (fds[i].revents & (POLLERR | POLLHUP | POLLNVAL));
+            if (!gone && (fds[i].revents & POLLIN)) {
+                // Clients don't send anything, reading only notices that they closed
+                char buf[256];
+                gone = recv(static_cast<socket_t>(c.socket), buf, sizeof(buf), 0) <= 0;
+            }
+            if (!gone && (fds[i].revents & POLLOUT))
+                gone = !Send(c);
+            if (gone)
+                c.closing = true;
+        }
+
+        for (auto& c : m_clients)
+            if (c.closing)
+                Close(c);
+        m_clients.erase(std::remove_if(m_clients.begin(), m_clients.end(), [](Client const& c) { return c.closing; }), m_clients.end());
+        m_num_clients = m_clients.size();
+    }
+}
+
+void StreamServer::Accept()
+{
+    auto s = accept(static_cast<socket_t>(m_listen), nullptr, nullptr);
+    if (s == Invalid)
+        return;
+
+    NonBlocking(s);
+    int on = 1;
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<char const*>(&on), sizeof(on));
+
+    std::scoped_lock<std::mutex> sl(m_mtx);
+    m_clients.push_back({static_cast<intptr_t>(s), {}});
+    if (m_hello)
+        m_clients.back().queue.push_back(m_hello);
+    m_num_clients = m_clients.size();
+}
+
+// Sends queued frames until the socket buffer is full
+bool StreamServer::Send(Client& client)
+{
+    while (!client.queue.empty()) {
+        auto const& frame = *client.queue.front();
+        auto        n     = send(static_cast<socket_t>(client.socket), reinterpret_cast<char const*>(frame.data() + client.sent),
+                                 static_cast<int>(frame.size() - client.sent), SendFlags);
+        if (n < 0)
+            return WouldBlock();
+
+        client.sent += n;
+        if (client.sent == frame.size()) {
+            client.queue.pop_front();
+            client.sent = 0;
+        }
+    }
+    return true;
+}
+
+void StreamServer::Close(Client& client)
+{
+    CloseSocket(static_cast<socket_t>(client.socket));
+    client.queue.clear();
+}
@@ -0,0 +1,190 @@
+#include "TaskPool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+namespace
+{
+// Pool and index of the worker running on this thread, so tasks posted from a worker go to its own deque
+thread_local TaskPool* t_pool{nullptr};
+thread_local size_t    t_worker{0};
+// Group tasks running on this thread, groups waited for inside them are part of the outer parallel section
+thread_local int       t_group_depth{0};
+} // namespace
+
+TaskPool& TaskPool::Get()
+{
+    static TaskPool pool(0);
+    return pool;
+}
+
+TaskPool::TaskPool(size_t workers)
+{
+    Start(workers);
+}
+
+TaskPool::~TaskPool()
+{
+    Stop();
+}
+
+void TaskPool::Resize(size_t workers)
+{
+    Stop();
+    Start(workers);
+}
+
+void TaskPool::Start(size_t workers)
+{
+    if (workers == 0)
+        workers = std::max(1u, std::thread::hardware_concurrency());
+
+    m_stop = false;
+    for (size_t i = 0; i < workers; ++i)
+        m_workers.push_back(std::make_unique<Worker>());
+    for (size_t i = 0; i < workers; ++i)
+        m_threads.emplace_back(&TaskPool::Loop, this, i);
+}
+
+// Workers finish all queued tasks before they exit
+void TaskPool::Stop()
+{
+    {
+        std::scoped_lock<std::mutex> sl(m_mtx);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    for (auto& t : m_threads)
+        t.join();
+    m_threads.clear();
+    m_workers.clear();
+}
+
+void TaskPool::Post(std::function<void()> task)
+{
+    size_t idx = t_pool == this ? t_worker : m_next++ % m_workers.size();
+    {
+        auto&                        w = *m_workers[idx];
+        std::scoped_lock<std::mutex> sl(w.mtx);
+        w.tasks.push_back(std::move(task));
+    }
+    m_queued++;
+    {
+        // Taken so the notification can't slip in between a worker's check and its wait
+        std::scoped_lock<std::mutex> sl(m_mtx);
+    }
+    m_cv.notify_one();
+}
+
+void TaskPool::Loop(size_t self)
+{
+    t_pool   = this;
+    t_worker = self;
+    while (true) {
+        if (TryRun(self))
+            continue;
+
+        std::unique_lock<std::mutex> lock(m_mtx);
+        m_cv.wait(lock, [this] { return m_stop || m_queued > 0; });
+        if (m_stop && m_queued == 0)
+            break;
+    }
+    t_pool = nullptr;
+}
+
+bool TaskPool::TryRun(size_t self)
+{
+    std::function<void()> task;
+
+    // Own tasks newest first, then steal the oldest task of another worker
+    if (self < m_workers.size()) {
+        auto&                        w = *m_workers[self];
+        std::scoped_lock<std::mutex> sl(w.mtx);
+        if (!w.tasks.empty()) {
+            task = std::move(w.tasks.back());
+            w.tasks.pop_back();
+        }
+    }
+    for (size_t i = 1; !task && i <= m_workers.size(); ++i) {
+        auto&                        w = *m_workers[(self + i) % m_workers.size()];
+        std::scoped_lock<std::mutex> sl(w.mtx);
+        if (!w.tasks.empty()) {
+            task = std::move(w.tasks.front());
+            w.tasks.pop_front();
+        }
+    }
+
+    if (!task)
+        return false;
+
+    m_queued--;
+    task();
+    return true;
+}
+
+TaskGroup::~TaskGroup()
+{
+    Cancel();
+    try {
+        Wait();
+    } catch (...) {
+        // Nobody is left to handle it
+    }
+}
+
+void TaskGroup::Run(std::function<void()> task)
+{
+    {
+        std::scoped_lock<std::mutex> sl(m_state->mtx);
+        if (m_state->pending == 0 && t_group_depth == 0)
+            m_state->parallel_since = std::chrono::steady_clock::now();
+        m_state->tasks.push_back(std::move(task));
+        m_state->pending++;
+    }
+    m_pool.Post([state = m_state] { RunOne(*state); });
+}
+
+bool TaskGroup::RunOne(State& state)
+{
+    std::function<void()> task;
+    {
+        std::scoped_lock<std::mutex> sl(state.mtx);
+        if (state.tasks.empty())
+            return false;
+        task = std::move(state.tasks.front());
+        state.tasks.pop_front();
+    }
+
+    if (!state.cancelled) {
+        t_group_depth++;
+        try {
+            task();
+        } catch (...) {
+            std::scoped_lock<std::mutex> sl(state.mtx);
+            if (!state.error)
+                state.error = std::current_exception();
+            state.cancelled = true;
+        }
+        t_group_depth--;
+    }
+
+    std::scoped_lock<std::mutex> sl(state.mtx);
+    if (--state.pending == 0)
+        state.cv.notify_all();
+    return true;
+}
+
+void TaskGroup::Wait()
+{
+    while (RunOne(*m_state))
+        ;
+
+    std::unique_lock<std::mutex> lock(m_state->mtx);
+    m_state->cv.wait(lock, [this] { return m_state->pending == 0; });
+    if (auto since = std::exchange(m_state->parallel_since, std::nullopt)) {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - *since).count();
+        m_pool.m_parallel_ns.fetch_add(ns, std::memory_order_relaxed);
+    }
+    if (auto error = std::exchange(m_state->error, nullptr))
+        std::rethrow_exception(error);
+}
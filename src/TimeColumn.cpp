@@ -0,0 +1,341 @@
+#include "TimeColumn.hpp"
+#include <algorithm>
+#include <optional>
+#include <sstream>
+
+namespace
+{
+void PutVarint(std::vector<uint8_t>& bytes, int64_t delta)
+{
+    uint64_t v = (static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63); // zigzag
+    while (v >= 0x80) {
+        bytes.push_back(static_cast<uint8_t>(v) | 0x80);
+        v >>= 7;
+    }
+    bytes.push_back(static_cast<uint8_t>(v));
+}
+
+int64_t GetVarint(const uint8_t*& p)
+{
+    uint64_t v     = 0;
+    int      shift = 0;
+    for (;; shift += 7) {
+        uint8_t b = *p++;
+        v |= static_cast<uint64_t>(b & 0x7F) << shift;
+        if (!(b & 0x80))
+            break;
+    }
+    return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+} // namespace
+
+TimeColumn::TimeColumn(TimeColumn const& other)
+{
+    std::scoped_lock<std::mutex> sl(other.m_mtx);
+    m_chunks  = other.m_chunks;
+    m_bytes   = other.m_bytes;
+    m_stored  = other.m_stored;
+    m_gaps    = other.m_gaps;
+    m_missing = other.m_missing;
+}
+
+Serializer::ser_data_t TimeColumn::Serialize() const
+{
+    ser_data_t         data;
+    std::vector<Entry> entries;
+    std::vector<Gap>   gaps;
+    {
+        std::scoped_lock<std::mutex> sl(m_mtx);
+        if (m_stored + m_missing == 0)
+            return data;
+        entries.resize(m_stored);
+        Decode(0, m_stored, entries.data());
+        gaps = m_gaps;
+    }
+
+    // Deltas are between stored entries, gaps come between them
+    auto write = [&](std::string const& name, auto field) {
+        Serializer::append(data, name);
+        auto gap = gaps.begin();
+        for (size_t i = 0; i <= entries.size(); ++i) {
+            for (; gap != gaps.end() && gap->stored == i; ++gap)
+                Serializer::append(data, "~" + std::to_string(gap->length));
+            if (i < entries.size())
+                Serializer::append(data, static_cast<int64_t>(entries[i].*field) - (i ? entries[i - 1].*field : 0));
+        }
+        data.pop_back();
+        Serializer::append(data, "\n", "");
+    };
+    write("time", &Entry::time_ms);
+    write("packet_id", &Entry::packet_id);
+    return data;
+}
+
+// Consumes the 'time' and 'packet_id' lines
+void TimeColumn::Deserialize(ser_data_t& data)
+{
+    // Values, and gaps as negative lengths
+    auto read_line = [&data](std::string const& name) {
+        auto                 newline_it = std::find(data.begin(), data.end(), '\n');
+        std::string          str(data.begin(), newline_it);
+        std::istringstream   ss(str);
+        std::string          str_tok;
+        std::vector<int64_t> values;
+        std::vector<size_t>  gaps; // length of the gap before values[i] is at gaps[i]
+
+        std::getline(ss, str_tok, Serializer::Delim[0]);
+        if (str_tok != name)
+            return std::make_pair(values, gaps); // line is left for whoever it belongs to
+
+        int64_t acc = 0;
+        size_t  gap = 0;
+        while (std::getline(ss, str_tok, Serializer::Delim[0])) {
+            if (!str_tok.empty() && str_tok[0] == '~') {
+                gap += std::stoul(str_tok.substr(1));
+            } else {
+                values.push_back(acc += std::stoll(str_tok));
+                gaps.push_back(gap);
+                gap = 0;
+            }
+        }
+        gaps.push_back(gap); // after the last value
+
+        data = ser_data_t(newline_it == data.end() ? data.end() : newline_it + 1, data.end());
+        return std::make_pair(values, gaps);
+    };
+
+    auto [times, gaps] = read_line("time");
+    auto ids           = read_line("packet_id").first;
+
+    clear();
+    size_t n = std::min(times.size(), ids.size());
+    for (size_t i = 0; i < n; ++i) {
+        if (gaps[i])
+            append_gap(gaps[i]);
+        push_back({static_cast<uint32_t>(times[i]), static_cast<uint32_t>(ids[i])});
+    }
+    if (n < gaps.size() && gaps[n])
+        append_gap(gaps[n]);
+}
+
+size_t TimeColumn::size() const
+{
+    std::scoped_lock<std::mutex> sl(m_mtx);
+    return m_stored + m_missing;
+}
+
+void TimeColumn::push_back(Entry e)
+{
+    std::scoped_lock<std::mutex> sl(m_mtx);
+    Encode(e);
+}
+
+void TimeColumn::append(const uint32_t* times, const uint32_t* packet_ids, size_t n)
+{
+    std::scoped_lock<std::mutex> sl(m_mtx);
+    for (size_t i = 0; i < n; ++i)
+        Encode({times[i], packet_ids[i]});
+}
+
+void TimeColumn::append_gap(size_t n)
+{
+    if (n == 0)
+        return;
+
+    std::scoped_lock<std::mutex> sl(m_mtx);
+    if (!m_gaps.empty() && m_gaps.back().stored == m_stored)
+        m_gaps.back().length += n;
+    else
+        m_gaps.push_back({m_stored + m_missing, n, m_stored});
+    m_missing += n;
+}
+
+size_t TimeColumn::Read(size_t begin, size_t n, Entry* out) const
+{
+    std::scoped_lock<std::mutex> sl(m_mtx);
+    return ReadLocked(begin, n, out);
+}
+
+TimeColumn::Entry TimeColumn::operator[](size_t idx) const
+{
+    Entry e{};
+    Read(idx, 1, &e);
+    return e;
+}
+
+TimeColumn::Entry TimeColumn::back() const
+{
+    std::scoped_lock<std::mutex> sl(m_mtx);
+    Entry                        e{};
+    if (m_stored + m_missing > 0)
+        ReadLocked(m_stored + m_missing - 1, 1, &e);
+    return e;
+}
+
+size_t TimeColumn::LowerBound(uint32_t time_ms) const
+{
+    std::scoped_lock<std::mutex> sl(m_mtx);
+
+    // Times don't decrease, so the chunk of the first stored entry at or after time_ms is found by its last entry
+    auto   chunk  = std::lower_bound(m_chunks.begin(), m_chunks.end(), time_ms, [](Chunk const& c, uint32_t t) { return c.last.time_ms < t; });
+    size_t stored = m_stored;
+    if (chunk != m_chunks.end()) {
+        std::vector<Entry> entries(chunk->count);
+        size_t             first = (chunk - m_chunks.begin()) * ChunkSize;
+        Decode(first, entries.size(), entries.data());
+        auto it = std::lower_bound(entries.begin(), entries.end(), time_ms, [](Entry const& e, uint32_t t) { return e.time_ms < t; });
+        stored  = first + (it - entries.begin());
+    }
+
+    // Entries of a gap right before it may already be at or after time_ms
+    size_t idx = stored + GapsBefore(stored);
+    auto   gap = std::upper_bound(m_gaps.begin(), m_gaps.end(), stored, [](size_t s, Gap const& g) { return s < g.stored; });
+    if (gap != m_gaps.begin() && (--gap)->stored == stored) {
+        auto [prev, next] = Around(*gap);
+        size_t lo = 0, hi = gap->length;
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (Interpolate(prev, next, mid, gap->length).time_ms < time_ms)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        idx = gap->begin + lo;
+    }
+    return idx;
+}
+
+void TimeColumn::Retime(size_t begin, size_t end, std::function<uint32_t(size_t, Entry const&)> const& time_of)
+{
+    std::scoped_lock<std::mutex> sl(m_mtx);
+    std::vector<Entry>           entries(m_stored);
+    Decode(0, m_stored, entries.data());
+
+    auto gap = m_gaps.begin();
+    for (size_t i = 0, missing = 0; i < entries.size(); ++i) {
+        for (; gap != m_gaps.end() && gap->stored == i; ++gap)
+            missing += gap->length;
+        if (i + missing >= begin && i + missing < end)
+            entries[i].time_ms = time_of(i + missing, entries[i]);
+    }
+
+    m_chunks.clear();
+    m_bytes.clear();
+    m_stored = 0;
+    for (auto const& e : entries)
+        Encode(e);
+}
+
+void TimeColumn::clear()
+{
+    std::scoped_lock<std::mutex> sl(m_mtx);
+    m_chunks.clear();
+    m_bytes.clear();
+    m_stored = 0;
+    m_gaps.clear();
+    m_missing = 0;
+}
+
+size_t TimeColumn::ResidentBytes() const
+{
+    std::scoped_lock<std::mutex> sl(m_mtx);
+    return m_chunks.capacity() * sizeof(Chunk) + m_bytes.capacity() + m_gaps.capacity() * sizeof(Gap);
+}
+
+void TimeColumn::Encode(Entry e)
+{
+    if (m_chunks.empty() || m_chunks.back().count == ChunkSize) {
+        m_chunks.push_back({e, e, 1, m_bytes.size()});
+    } else {
+        auto& chunk = m_chunks.back();
+        PutVarint(m_bytes, static_cast<int64_t>(e.time_ms) - chunk.last.time_ms);
+        PutVarint(m_bytes, static_cast<int64_t>(e.packet_id) - chunk.last.packet_id);
+        chunk.last = e;
+        chunk.count++;
+    }
+    m_stored++;
+}
+
+void TimeColumn::Decode(size_t begin, size_t n, Entry* out) const
+{
+    size_t copied = 0;
+    for (size_t c = begin / ChunkSize; copied < n; ++c) {
+        auto const&    chunk = m_chunks[c];
+        Entry          e     = chunk.base;
+        const uint8_t* p     = m_bytes.data() + chunk.offset;
+        for (size_t i = c * ChunkSize, end = i + chunk.count; i < end && copied < n; ++i) {
+            if (i != c * ChunkSize) {
+                e.time_ms += static_cast<uint32_t>(GetVarint(p));
+                e.packet_id += static_cast<uint32_t>(GetVarint(p));
+            }
+            if (i >= begin)
+                out[copied++] = e;
+        }
+    }
+}
+
+TimeColumn::Entry TimeColumn::Stored(size_t idx) const
+{
+    Entry e{};
+    Decode(idx, 1, &e);
+    return e;
+}
+
+size_t TimeColumn::ReadLocked(size_t begin, size_t n, Entry* out) const
+{
+    size_t total = m_stored + m_missing;
+    if (begin >= total)
+        return 0;
+    n = std::min(n, total - begin);
+
+    // First gap that ends after begin, parts before it are stored entries
+    auto gap = std::upper_bound(m_gaps.begin(), m_gaps.end(), begin, [](size_t idx, Gap const& g) { return idx < g.begin + g.length; });
+    for (size_t pos = begin, end = begin + n; pos < end;) {
+        if (gap == m_gaps.end() || pos < gap->begin) {
+            size_t k       = std::min(end, gap == m_gaps.end() ? end : gap->begin) - pos;
+            size_t missing = gap == m_gaps.end() ? m_missing : gap->begin - gap->stored; // before pos
+            Decode(pos - missing, k, out + (pos - begin));
+            pos += k;
+        } else {
+            auto [prev, next] = Around(*gap);
+            for (; pos < end && pos < gap->begin + gap->length; ++pos)
+                out[pos - begin] = Interpolate(prev, next, pos - gap->begin, gap->length);
+            ++gap;
+        }
+    }
+    return n;
+}
+
+// Entries before and after the gap. Without an entry after it (yet) the gap is counted on from the one before it,
+// a gap at the start takes the entry after it.
+std::pair<TimeColumn::Entry, std::optional<TimeColumn::Entry>> TimeColumn::Around(Gap const& gap) const
+{
+    std::optional<Entry> next;
+    if (gap.stored < m_stored)
+        next = Stored(gap.stored);
+    if (gap.stored == 0)
+        return {next.value_or(Entry{}), next};
+    return {Stored(gap.stored - 1), next};
+}
+
+// k-th entry (from 0) of a gap of length entries, times and ids are spread evenly between the entries around it
+TimeColumn::Entry TimeColumn::Interpolate(Entry prev, std::optional<Entry> next, size_t k, size_t length)
+{
+    auto step = static_cast<int64_t>(k + 1);
+    if (!next)
+        return {prev.time_ms, static_cast<uint32_t>(prev.packet_id + step)};
+
+    auto parts = static_cast<int64_t>(length + 1);
+    auto time  = prev.time_ms + (static_cast<int64_t>(next->time_ms) - prev.time_ms) * step / parts;
+    auto id    = prev.packet_id + static_cast<int64_t>(static_cast<int32_t>(next->packet_id - prev.packet_id)) * step / parts;
+    return {static_cast<uint32_t>(time), static_cast<uint32_t>(id)};
+}
+
+size_t TimeColumn::GapsBefore(size_t stored) const
+{
+    auto gap = std::upper_bound(m_gaps.begin(), m_gaps.end(), stored, [](size_t s, Gap const& g) { return s < g.stored; });
+    if (gap == m_gaps.begin())
+        return 0;
+    --gap;
+    return gap->begin + gap->length - gap->stored;
+}
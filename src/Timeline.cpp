@@ -0,0 +1,56 @@
+#include "Timeline.hpp"
+#include <algorithm>
+
+void Timeline::Add(std::shared_ptr<TimeColumn const> const& time, size_t size, uint32_t sampling_period_ms)
+{
+    auto& s  = m_sources.emplace_back();
+    s.time   = time && time->size() >= size ? time : nullptr;
+    s.size   = size;
+    s.period = sampling_period_ms;
+    Push(m_sources.size() - 1);
+}
+
+void Timeline::Seek(uint32_t time_ms)
+{
+    m_heap = {};
+    for (size_t i = 0; i < m_sources.size(); ++i) {
+        auto& s = m_sources[i];
+        if (s.time)
+            s.next = std::min(s.time->LowerBound(time_ms), s.size);
+        else
+            s.next = s.period > 0 ? std::min<size_t>((time_ms + s.period - 1) / s.period, s.size) : 0;
+        Push(i);
+    }
+}
+
+bool Timeline::Next(Event& e)
+{
+    if (m_heap.empty())
+        return false;
+
+    auto [time_ms, source] = m_heap.top();
+    m_heap.pop();
+    e = {source, m_sources[source].next++, time_ms};
+    Push(source);
+    return true;
+}
+
+uint32_t Timeline::TimeAt(Source& s, size_t idx)
+{
+    if (!s.time)
+        return static_cast<uint32_t>(idx * s.period);
+
+    if (idx < s.chunk_begin || idx >= s.chunk_begin + s.chunk.size()) {
+        s.chunk.resize(TimeColumn::ChunkSize);
+        s.chunk.resize(s.time->Read(idx, s.chunk.size(), s.chunk.data()));
+        s.chunk_begin = idx;
+    }
+    return s.chunk[idx - s.chunk_begin].time_ms;
+}
+
+void Timeline::Push(size_t source)
+{
+    auto& s = m_sources[source];
+    if (s.next < s.size)
+        m_heap.push({TimeAt(s, s.next), source});
+}
@@ -7,6 +7,7 @@ Window::Window(int w, int h, const std::string& title, sf::Uint32 style)
 
     // Make room for plenty widgets, to avoid reallocations.
     m_widgets.reserve(100);
+    m_hit_bounds.reserve(100);
     //m_window->setFramerateLimit(60); // currently already m_running at 60 fps even without limit
 }
 
@@ -17,10 +18,47 @@ void Window::Events()
             m_window->close();
         }
 
-        for (int i = 0; i < m_widgets.size(); ++i) {
-            m_widgets[i]->Handle(*m_event);
-        }
+        Dispatch(*m_event);
+    }
+}
+
+// Mouse events are only passed to widgets under the cursor, plus the previously hovered widget (so it sees the
+// mouse leaving) and the widget that got the button press (so it sees the release). Other events are broadcast.
+void Window::Dispatch(const sf::Event& event)
+{
+    std::optional<sf::Vector2f> pos;
+    if (event.type == sf::Event::MouseMoved)
+        pos = sf::Vector2f(event.mouseMove.x, event.mouseMove.y);
+    else if (event.type == sf::Event::MouseButtonPressed || event.type == sf::Event::MouseButtonReleased)
+        pos = sf::Vector2f(event.mouseButton.x, event.mouseButton.y);
+    else if (event.type == sf::Event::MouseWheelScrolled)
+        pos = sf::Vector2f(event.mouseWheelScroll.x, event.mouseWheelScroll.y);
+
+    if (!pos) {
+        for (size_t i = 0; i < m_widgets.size(); ++i)
+            m_widgets[i]->Handle(event);
+        return;
+    }
+
+    auto    prev_hovered = m_hovered;
+    auto    prev_pressed = m_pressed;
+    Widget* hovered      = nullptr;
+    for (int i = 0; i < m_widgets.size(); ++i) {
+        auto widget = m_widgets[i].get();
+        auto bounds = m_hit_bounds[i];
+        bool hit    = bounds && bounds->contains(*pos);
+        if (hit)
+            hovered = widget;
+
+        if (!bounds || hit || widget == prev_hovered || (event.type == sf::Event::MouseButtonReleased && widget == prev_pressed))
+            widget->Handle(event);
     }
+
+    m_hovered = hovered;
+    if (event.type == sf::Event::MouseButtonPressed)
+        m_pressed = hovered;
+    else if (event.type == sf::Event::MouseButtonReleased)
+        m_pressed = nullptr;
 }
 
 void Window::Create(int w, int h, const std::string& title, sf::Uint32 style)
@@ -36,13 +74,26 @@ void Window::Close()
 void Window::Add(std::shared_ptr<Widget> const& widget)
 {
     m_widgets.push_back(widget);
+    m_hit_bounds.push_back(std::nullopt);
+}
+
+void Window::Add(std::shared_ptr<Widget> const& widget, sf::FloatRect const& hit_bounds)
+{
+    m_widgets.push_back(widget);
+    m_hit_bounds.push_back(hit_bounds);
 }
 
 void Window::Remove(std::shared_ptr<Widget> const& widget)
 {
     auto it = std::find(m_widgets.begin(), m_widgets.end(), widget);
-    if (it != m_widgets.end())
+    if (it != m_widgets.end()) {
+        m_hit_bounds.erase(m_hit_bounds.begin() + (it - m_widgets.begin()));
         m_widgets.erase(it);
+    }
+    if (m_hovered == widget.get())
+        m_hovered = nullptr;
+    if (m_pressed == widget.get())
+        m_pressed = nullptr;
 }
 
 void Window::Draw()
@@ -1,7 +1,39 @@
 #include "Application.hpp"
+#include "HeadlessRenderer.hpp"
+#include "RenderBenchmark.hpp"
+#include <iostream>
+#include <mygui/ResourceManager.hpp>
 
 int main(int argc, char* argv[])
 {
+    std::optional<RenderBenchmarkOptions> render_bench;
+    try {
+        render_bench = RenderBenchmark::ParseArguments(argc, argv);
+    } catch (std::exception const& e) {
+        std::cerr << e.what() << "\n"
+                  << RenderBenchmark::Usage();
+        return 1;
+    }
+
+    if (render_bench) {
+        mygui::ResourceManager::SetSystemFontName("segoeui.ttf");
+        return RenderBenchmark(*render_bench).Run();
+    }
+
+    std::optional<HeadlessOptions> headless;
+    try {
+        headless = HeadlessRenderer::ParseArguments(argc, argv);
+    } catch (std::exception const& e) {
+        std::cerr << e.what() << "\n"
+                  << HeadlessRenderer::Usage();
+        return 1;
+    }
+
+    if (headless) {
+        mygui::ResourceManager::SetSystemFontName("segoeui.ttf");
+        return HeadlessRenderer(*headless).Run() == 0 ? 0 : 1;
+    }
+
     Application app;
 
     app.MainLoop();
@@ -0,0 +1,211 @@
+#include "ClockFit.hpp"
+#include "Filters.hpp"
+#include "Retention.hpp"
+#include "SampleStore.hpp"
+#include "TimeColumn.hpp"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <limits>
+#include <random>
+#include <vector>
+
+// Tests of the core that don't need SFML or devices. A failed check is printed and the exit code is the number of
+// failed checks, so it runs under ctest without a test framework.
+namespace
+{
+int g_failed = 0;
+
+void Check(bool ok, char const* what, int line)
+{
+    if (!ok) {
+        std::printf("%s:%d: check failed: %s\n", __FILE__, line, what);
+        g_failed++;
+    }
+}
+
+#define CHECK(cond) Check((cond), #cond, __LINE__)
+
+// The dispatched kernels (SSE4.1 on CPUs that have it) give the same results as the scalar ones, for every length
+// around the vector width and the extremes of the range
+void MedianKernels()
+{
+    std::mt19937                            rng(1);
+    std::uniform_int_distribution<uint32_t> dist;
+    for (size_t n = 0; n <= 37; ++n) {
+        std::vector<uint32_t> in(n + 4);
+        for (auto& v : in) {
+            auto r = rng() % 4;
+            v      = r == 0 ? 0 : r == 1 ? std::numeric_limits<uint32_t>::max() : dist(rng);
+        }
+
+        std::vector<uint32_t> out(n), expected(n);
+        Kernels::Median3(in.data(), out.data(), n);
+        Kernels::Median3Scalar(in.data(), expected.data(), n);
+        CHECK(out == expected);
+        Kernels::Median5(in.data(), out.data(), n);
+        Kernels::Median5Scalar(in.data(), expected.data(), n);
+        CHECK(out == expected);
+    }
+}
+
+// After a reset (a gap) the median window starts over, it doesn't reach back to the samples before it
+void FilterReset()
+{
+    DeviceFilter                       filter({5, 1, 0});
+    std::vector<std::vector<uint32_t>> columns{{100, 100, 100, 100}};
+    filter.Process(columns, 1);
+    filter.Reset();
+    columns = {{7, 7, 7}};
+    filter.Process(columns, 1);
+    CHECK(columns[0] == std::vector<uint32_t>({7, 7, 7}));
+}
+
+// Columns after the node ones keep the last sample of every decimation group, unfiltered and without a raw ring
+void FilterSideColumns()
+{
+    DeviceFilter                       filter({3, 2, 4});
+    std::vector<std::vector<uint32_t>> columns{{10, 20, 30, 40, 50}, {100, 111, 120, 130, 140}};
+    filter.Process(columns, 1);
+    CHECK(columns[0].size() == 2);
+    CHECK(columns[1] == std::vector<uint32_t>({111, 130}));
+    columns = {{60}, {150}};
+    filter.Process(columns, 1);
+    CHECK(columns[0].size() == 1);
+    CHECK(columns[1] == std::vector<uint32_t>({150}));
+    CHECK(filter.RawHistory(0).size() == 4 && filter.RawHistory(1).empty());
+}
+
+// NaN can't be converted to a 16 bit sample, it is stored as a gap and read as Missing; values out of range saturate
+void SampleStoreNaN()
+{
+    auto  store = SampleStore::Create(SampleWidth::U16);
+    float nan   = std::numeric_limits<float>::quiet_NaN();
+    store->append(std::vector<float>{1.f, nan, nan, 70000.f, -5.f, 3.f, nan});
+    CHECK(store->size() == 7);
+
+    std::vector<uint32_t> raw(7);
+    store->Read(0, raw.size(), raw.data());
+    CHECK(raw == std::vector<uint32_t>({1, SampleStore::Missing, SampleStore::Missing, 65535, 0, 3, SampleStore::Missing}));
+
+    std::vector<float> values(7);
+    store->Read(0, values.size(), values.data());
+    CHECK(values[0] == 1.f && std::isnan(values[1]) && std::isnan(values[2]) && values[5] == 3.f && std::isnan(values[6]));
+    CHECK(store->Gaps().size() == 2);
+}
+
+// Floats at or above 2^32 saturate to the largest float below it, 2^32 itself doesn't fit a uint32_t
+void SampleStoreSaturation()
+{
+    auto store = SampleStore::Create(SampleWidth::U32);
+    store->append(std::vector<float>{4294967296.f, 1e10f, 4294967040.f, 7.f});
+
+    std::vector<uint32_t> raw(4);
+    store->Read(0, raw.size(), raw.data());
+    CHECK(raw == std::vector<uint32_t>({4294967040u, 4294967040u, 4294967040u, 7}));
+}
+
+// Blocks stored while there was no budget are spilled once one is set
+void RetentionLateBudget()
+{
+    auto& retention = Retention::Get();
+    {
+        constexpr size_t      block = BlockStore<uint32_t>::BlockSize;
+        BlockStore<uint32_t>  store;
+        std::vector<uint32_t> data(4 * block, 7);
+        store.append(data);
+        retention.SetBudget(2 * block * sizeof(uint32_t));
+        CHECK(store.ResidentBytes() <= 2 * block * sizeof(uint32_t));
+        CHECK(store[0] == 7 && store[3 * block] == 7);
+    }
+    retention.SetBudget(0);
+}
+
+// A gap is one run however long it is, its entries are spread between the entries around it when read
+void TimeColumnGaps()
+{
+    TimeColumn time;
+    time.push_back({1000, 10});
+    time.append_gap(3);
+    CHECK(time.size() == 4);
+    CHECK(time.back().time_ms == 1000 && time.back().packet_id == 13); // nothing after it yet
+
+    time.push_back({1400, 14});
+    time.append_gap(1000000000);
+    time.push_back({2000, 1000000015});
+    CHECK(time.size() == 1000000006);
+    CHECK(time.ResidentBytes() < 4096);
+
+    std::vector<TimeColumn::Entry> e(6);
+    CHECK(time.Read(0, e.size(), e.data()) == 6);
+    CHECK(e[1].time_ms == 1100 && e[2].time_ms == 1200 && e[3].time_ms == 1300 && e[4].time_ms == 1400);
+    CHECK(e[1].packet_id == 11 && e[3].packet_id == 13 && e[5].packet_id == 15);
+    CHECK(time[1000000005].time_ms == 2000);
+
+    CHECK(time.LowerBound(1000) == 0);
+    CHECK(time.LowerBound(1150) == 2);
+    CHECK(time.LowerBound(1400) == 4);
+    CHECK(time.LowerBound(1700) == 500000005); // halfway through the long gap
+    CHECK(time.LowerBound(2000) == 1000000005);
+    CHECK(time.LowerBound(2001) == time.size());
+
+    // Captures keep the gaps as runs
+    auto       data = time.Serialize();
+    TimeColumn loaded;
+    loaded.Deserialize(data);
+    CHECK(loaded.size() == time.size() && loaded.ResidentBytes() < 4096);
+    CHECK(loaded[2].time_ms == 1200 && loaded[1000000005].packet_id == 1000000015);
+
+    // Retimed entries move the gap entries next to them
+    loaded.Retime(0, 1, [](size_t, TimeColumn::Entry const& e) { return e.time_ms + 100; });
+    CHECK(loaded[0].time_ms == 1100 && loaded[2].time_ms == 1250 && loaded[4].time_ms == 1400);
+}
+} // namespace
+
+// A fit keeps the first entry of its segment through a capture file, fits of older captures don't know it
+void ClockFitSegments()
+{
+    ClockFit fit(40);
+    for (uint32_t id = 1000; id < 1020; ++id)
+        fit.Add(id, 5. + 2.5 * (id - 1000));
+    CHECK(fit.Valid());
+
+    auto     data = fit.Serialize();
+    ClockFit loaded;
+    loaded.Deserialize(data);
+    CHECK(data.empty());
+    CHECK(loaded.Begin() == size_t{40});
+    CHECK(std::abs(loaded.Map(1100) - fit.Map(1100)) < 1e-9);
+
+    std::string            line = "clock,1000,5,2.5,20\n";
+    Serializer::ser_data_t legacy(line.begin(), line.end());
+    loaded.Deserialize(legacy);
+    CHECK(legacy.empty());
+    CHECK(loaded.Valid() && !loaded.Begin());
+
+    // Ids going backwards restart the fit of the same segment
+    fit.Add(3, 100.);
+    CHECK(fit.Observations() == 1 && fit.Begin() == size_t{40});
+}
+
+int main()
+{
+    std::vector<std::pair<char const*, std::function<void()>>> tests{
+        {"median kernels", MedianKernels},
+        {"filter reset", FilterReset},
+        {"filter side columns", FilterSideColumns},
+        {"sample store NaN", SampleStoreNaN},
+        {"sample store saturation", SampleStoreSaturation},
+        {"retention late budget", RetentionLateBudget},
+        {"time column gaps", TimeColumnGaps},
+        {"clock fit segments", ClockFitSegments},
+    };
+
+    for (auto const& [name, test] : tests) {
+        int failed = g_failed;
+        test();
+        std::printf("%s: %s\n", name, g_failed == failed ? "ok" : "FAILED");
+    }
+    return g_failed;
+}